@@ -35,9 +35,9 @@ using namespace std;
 size_t Agent::pick_move_idx(DynamicVector<double>& policyProbSmall)
 {
     double* prob = policyProbSmall.data();
-    default_random_engine eng{static_cast<long unsigned int>(time(0))};
+    // the agent's own generator avoids that agents which sample at the same time pick the same move
     discrete_distribution<> d(prob, prob+policyProbSmall.size());
-    return size_t(d(eng));
+    return size_t(d(gen));
 }
 
 void Agent::apply_temperature_to_policy(DynamicVector<double> &policyProbSmall)
@@ -94,9 +94,5 @@ void Agent::perform_action(Board *pos, SearchLimits* searchLimits, EvalInfo& eva
 //    else {
         cout << "bestmove " << UCI::move(evalInfo.bestMove, pos->is_chess960()) << endl;
 //    }
-#ifdef USE_RL
-    exporter.export_pos(pos, evalInfo, pos->game_ply());
-    exporter.export_best_move_q(evalInfo, pos->game_ply());
-#endif
 }
 
@@ -45,6 +45,7 @@ SearchLimits::SearchLimits():
     npmsec(0),
     startTime(0),
     moveOverhead(0),
+    adaptiveMoveOverhead(false),
     infinite(false),
     ponder(false)
 {
@@ -44,6 +44,8 @@ public:
     TimePoint npmsec;
     TimePoint startTime;
     int moveOverhead;
+    // if true, the move overhead is calibrated on the measured lag of previous moves and moveOverhead is only the initial value
+    bool adaptiveMoveOverhead;
     bool infinite;
     bool ponder;
 
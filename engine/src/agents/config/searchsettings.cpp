@@ -45,6 +45,7 @@ SearchSettings::SearchSettings():
         qThreshMax(0.9f),
         qThreshBase(1965.0f),
         randomMoveFactor(0.0f),
+        nnCacheSize(200000),
         threshCheck(0.1f),
         checkFactor(0.5f),
         threshCapture(0.1f),
@@ -54,6 +54,8 @@ struct SearchSettings
     float qThreshMax;
     float qThreshBase;
     float randomMoveFactor;
+    // maximum number of positions which are stored in the neural network cache (0 disables the cache)
+    size_t nnCacheSize;
 
     // adaption of checking and capture moves (currently not as UCI parameters)
     // Threshold probability for checking moves
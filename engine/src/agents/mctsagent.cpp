@@ -34,6 +34,7 @@
 #include "uci.h"
 #include "../manager/statesmanager.h"
 #include "../manager/treemanager.h"
+#include "thread.h"
 #include "../node.h"
 
 using namespace mxnet::cpp;
@@ -45,6 +46,8 @@ MCTSAgent::MCTSAgent(NeuralNetAPI *netSingle, NeuralNetAPI** netBatches,
     Agent(playSettings.temperature, playSettings.temperatureMoves, true),
     netSingle(netSingle),
     netBatches(netBatches),
+    sharedNetBatch(nullptr),
+    firstSlotIdx(0),
     searchSettings(searchSettings),
     playSettings(playSettings),
     rootNode(nullptr),
@@ -53,33 +56,67 @@ MCTSAgent::MCTSAgent(NeuralNetAPI *netSingle, NeuralNetAPI** netBatches,
     opponentsNextRoot(nullptr),
     states(states),
     lastValueEval(-1.0f),
-    reusedFullTree(false)
+    reusedFullTree(false),
+    searchStartTime(0),
+    searchStopTime(0),
+    isTimeManaged(false)
 {
-    hashTable = new unordered_map<Key, Node*>;
-    hashTable->reserve(1e6);
-
+    init_search_structures();
     for (auto i = 0; i < searchSettings->threads; ++i) {
-        searchThreads.push_back(new SearchThread(netBatches[i], searchSettings, hashTable));
+        searchThreads.push_back(new SearchThread(netBatches[i], searchSettings, hashTable, &hashTableMtx, nnCache));
     }
+}
 
-    valueOutput = new NDArray(Shape(1, 1), Context::cpu());
-
-    if (netSingle->is_policy_map()) {
-        probOutputs = new NDArray(Shape(1, NB_LABELS_POLICY_MAP), Context::cpu());
-    } else {
-        probOutputs = new NDArray(Shape(1, NB_LABELS), Context::cpu());
+MCTSAgent::MCTSAgent(SharedNetBatch* sharedNetBatch, size_t firstSlotIdx,
+                     SearchSettings* searchSettings, PlaySettings playSettings,
+                     StatesManager* states):
+    Agent(playSettings.temperature, playSettings.temperatureMoves, true),
+    netSingle(nullptr),
+    netBatches(nullptr),
+    sharedNetBatch(sharedNetBatch),
+    firstSlotIdx(firstSlotIdx),
+    searchSettings(searchSettings),
+    playSettings(playSettings),
+    rootNode(nullptr),
+    oldestRootNode(nullptr),
+    ownNextRoot(nullptr),
+    opponentsNextRoot(nullptr),
+    states(states),
+    lastValueEval(-1.0f),
+    reusedFullTree(false),
+    searchStartTime(0),
+    searchStopTime(0),
+    isTimeManaged(false)
+{
+    init_search_structures();
+    for (auto i = 0; i < searchSettings->threads; ++i) {
+        searchThreads.push_back(new SearchThread(sharedNetBatch, firstSlotIdx + i, searchSettings, hashTable, &hashTableMtx, nnCache));
     }
+}
+
+void MCTSAgent::init_search_structures()
+{
+    treeSnapshot = nullptr;
+    hashTable = new unordered_map<Key, Node*>;
+    hashTable->reserve(1e6);
+    reclaimer = new SubtreeReclaimer(hashTable, &hashTableMtx);
+    nnCache = new NNCache(searchSettings->nnCacheSize);
+    nnCacheParameterVersion = 0;
+    valueOutput = nullptr;
+    probOutputs = nullptr;
     timeManager = new TimeManager(searchSettings->randomMoveFactor);
     generator = default_random_engine(r());
-    fill(inputPlanes, inputPlanes+NB_VALUES_TOTAL, 0.0f);  // will be filled in evalute_board_state()
 }
 
 MCTSAgent::~MCTSAgent()
 {
+    delete reclaimer;
+    delete treeSnapshot;
     delete netSingle;
     delete netBatches;
     delete searchSettings;
     delete hashTable;
+    delete nnCache;
 }
 
 Node* MCTSAgent::get_opponents_next_root() const
@@ -92,6 +129,52 @@ Node* MCTSAgent::get_root_node() const
     return rootNode;
 }
 
+void MCTSAgent::get_nn_statistics(size_t& evaluatedNodes, size_t& batchCapacity) const
+{
+    if (sharedNetBatch != nullptr) {
+        // the mini-batches of the search threads are only parts of the batches which are actually evaluated
+        sharedNetBatch->get_nn_statistics(evaluatedNodes, batchCapacity);
+        return;
+    }
+    evaluatedNodes = 0;
+    batchCapacity = 0;
+    for (const SearchThread* searchThread : searchThreads) {
+        evaluatedNodes += searchThread->get_number_evaluated_nodes();
+        batchCapacity += searchThread->get_number_mini_batches() * searchSettings->batchSize;
+    }
+}
+
+bool MCTSAgent::uses_shared_net_batch() const
+{
+    return sharedNetBatch != nullptr;
+}
+
+void MCTSAgent::get_collision_statistics(size_t& selections, size_t& collisions) const
+{
+    selections = 0;
+    collisions = 0;
+    for (const SearchThread* searchThread : searchThreads) {
+        selections += searchThread->get_number_selections();
+        collisions += searchThread->get_number_collisions();
+    }
+}
+
+double MCTSAgent::get_time_to_first_batch() const
+{
+    double timeToFirstBatch = -1;
+    for (const SearchThread* searchThread : searchThreads) {
+        const chrono::steady_clock::time_point firstPredictionTime = searchThread->get_first_prediction_time();
+        if (firstPredictionTime == chrono::steady_clock::time_point() || firstPredictionTime < searchThreadsStartTime) {
+            continue;
+        }
+        const double elapsedMS = chrono::duration<double, milli>(firstPredictionTime - searchThreadsStartTime).count();
+        if (timeToFirstBatch < 0 || elapsedMS < timeToFirstBatch) {
+            timeToFirstBatch = elapsedMS;
+        }
+    }
+    return timeToFirstBatch;
+}
+
 size_t MCTSAgent::init_root_node(Board *pos)
 {
     size_t nodesPreSearch;
@@ -125,31 +208,99 @@ Node *MCTSAgent::get_root_node_from_tree(Board *pos)
     }
 
     if (same_hash_key(ownNextRoot, pos)) {
-        delete_sibling_subtrees(ownNextRoot, hashTable);
-        delete_sibling_subtrees(opponentsNextRoot, hashTable);
+        reclaim_sibling_subtrees(ownNextRoot);
+        reclaim_sibling_subtrees(opponentsNextRoot);
         return ownNextRoot;
     }
     if (same_hash_key(opponentsNextRoot, pos)) {
-        delete_sibling_subtrees(opponentsNextRoot, hashTable);
+        reclaim_sibling_subtrees(opponentsNextRoot);
         return opponentsNextRoot;
     }
-    return nullptr;
+
+    // the position might be further down the tree, e.g. when jumping through a line in analysis
+    const vector<Node*> path = get_node_path(rootNode, pos);
+    if (path.empty()) {
+        return nullptr;
+    }
+    cout << "info string reuse the subtree " << path.size() << " plies below the root" << endl;
+    for (Node* node : path) {
+        // only the subtree of the new root stays reachable
+        reclaim_sibling_subtrees(node);
+        if (find(gameNodes.begin(), gameNodes.end(), node) == gameNodes.end()) {
+            gameNodes.push_back(node);
+        }
+    }
+    // the former candidates might have been deleted
+    ownNextRoot = nullptr;
+    opponentsNextRoot = nullptr;
+    return path.back();
+}
+
+void MCTSAgent::reclaim_sibling_subtrees(Node* node)
+{
+    // the game nodes are deleted when the game history is cleared, so they must not be freed by the reclaimer as well
+    remove_sibling_subtree_nodes(gameNodes, node);
+    reclaimer->reclaim_sibling_subtrees(node);
 }
 
 void MCTSAgent::stop_search_based_on_limits()
 {
-    int curMovetime = timeManager->get_time_for_move(searchLimits, rootNode->get_pos()->side_to_move(), rootNode->get_pos()->plies_from_null()/2);
-    cout << "info string movetime " << curMovetime << endl;
-    this_thread::sleep_for(chrono::milliseconds(curMovetime/2));
-    if (early_stopping()) {
-        stop_search();
-    } else {
-        this_thread::sleep_for(chrono::milliseconds(curMovetime/2));
-        if (continue_search()) {
-            this_thread::sleep_for(chrono::milliseconds(curMovetime/2));
+    const Color me = rootNode->get_pos()->side_to_move();
+    int curMovetime = timeManager->get_time_for_move(searchLimits, me, rootNode->get_pos()->plies_from_null()/2);
+    cout << "info string movetime " << curMovetime << " time bank " << timeManager->get_time_bank(me) << endl;
+    const float visitsPreSearch = rootNode->get_visits();
+    const TimePoint startTime = now();
+    searchStartTime = startTime;
+    TimePoint elapsedTime = 0;
+    bool checkedEarlyStopping = false;
+    bool checkedContinueSearch = false;
+
+    while (elapsedTime < curMovetime) {
+        this_thread::sleep_for(chrono::milliseconds(min(TimePoint(TIME_CHECK_INTERVAL_MS), curMovetime - elapsedTime)));
+        elapsedTime = now() - startTime;
+
+        if (!checkedEarlyStopping && elapsedTime >= curMovetime / 2) {
+            checkedEarlyStopping = true;
+            if (early_stopping()) {
+                break;
+            }
+        }
+        if (is_best_move_decided(elapsedTime, curMovetime, visitsPreSearch)) {
+            break;
+        }
+        if (!checkedContinueSearch && elapsedTime >= curMovetime) {
+            checkedContinueSearch = true;
+            if (continue_search()) {
+                // critical positions receive the time which has been saved on previous moves
+                const int bankedTime = timeManager->take_from_time_bank(me, curMovetime);
+                cout << "info string use " << bankedTime << "ms from the time bank" << endl;
+                curMovetime += curMovetime / 2 + bankedTime;
+            }
+        }
+    }
+    stop_search();
+    searchStopTime = now();
+    isTimeManaged = true;
+    timeManager->save_time(searchLimits, me, curMovetime - int(elapsedTime));
+}
+
+void MCTSAgent::stop_search_based_on_movetime(TimePoint movetime)
+{
+    const TimePoint startTime = now();
+    while (is_search_running() && now() - startTime < movetime) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    stop_search();
+}
+
+bool MCTSAgent::is_search_running() const
+{
+    for (auto searchThread : searchThreads) {
+        if (searchThread->get_is_running()) {
+            return true;
         }
-        stop_search();
     }
+    return false;
 }
 
 void MCTSAgent::stop_search()
@@ -168,6 +319,40 @@ bool MCTSAgent::early_stopping()
     return false;
 }
 
+bool MCTSAgent::is_best_move_decided(TimePoint elapsedTime, int curMovetime, float visitsPreSearch)
+{
+    if (elapsedTime < curMovetime * MIN_MOVETIME_PORTION_DECIDED || rootNode->get_number_child_nodes() < 2) {
+        // the nodes per second estimate isn't reliable at the start of the search
+        return false;
+    }
+    const DynamicVector<float> childNumberVisits = retrieve_visits(rootNode);
+    size_t firstIdx = 0;
+    size_t secondIdx = 1;
+    if (childNumberVisits[secondIdx] > childNumberVisits[firstIdx]) {
+        swap(firstIdx, secondIdx);
+    }
+    for (size_t idx = 2; idx < childNumberVisits.size(); ++idx) {
+        if (childNumberVisits[idx] > childNumberVisits[firstIdx]) {
+            secondIdx = firstIdx;
+            firstIdx = idx;
+        }
+        else if (childNumberVisits[idx] > childNumberVisits[secondIdx]) {
+            secondIdx = idx;
+        }
+    }
+    const float visitsPerMs = (rootNode->get_visits() - visitsPreSearch) / float(max(elapsedTime, TimePoint(1)));
+    const float remainingVisits = visitsPerMs * max(TimePoint(0), curMovetime - elapsedTime);
+    const vector<Node*>& childNodes = rootNode->get_child_nodes();
+
+    // the Q-value of the best move must also be superior because it can influence the final move selection
+    if (childNumberVisits[firstIdx] - childNumberVisits[secondIdx] > remainingVisits &&
+            childNodes[firstIdx]->get_q_value() >= childNodes[secondIdx]->get_q_value()) {
+        cout << "info string Best move can't be overtaken -> early stopping" << endl;
+        return true;
+    }
+    return false;
+}
+
 bool MCTSAgent::continue_search() {
     if (searchLimits->movetime == 0 && searchLimits->movestogo != 1 && rootNode->candidate_child_node()->get_q_value()+0.1f < lastValueEval) {
         cout << "info Increase search time" << endl;
@@ -183,19 +368,38 @@ void MCTSAgent::create_new_root_node(Board *pos)
     if (oldestRootNode != nullptr) {
         cout << "info string delete the old tree " << endl;
         if (opponentsNextRoot != nullptr) {
-            delete_sibling_subtrees(opponentsNextRoot, hashTable);
+            reclaim_sibling_subtrees(opponentsNextRoot);
         }
     }
     cout << "info string create new tree" << endl;
     rootNode = new Node(newPos, nullptr, MOVE_NONE, searchSettings);
     rootNode->expand();
     oldestRootNode = rootNode;
-    board_to_planes(pos, 0, true, begin(inputPlanes));
-    netSingle->predict(inputPlanes, *valueOutput, *probOutputs);
-    fill_nn_results(0, netSingle->is_policy_map(), searchSettings, valueOutput, probOutputs, rootNode);
+    if (!probe_nn_cache(rootNode, nnCache)) {
+        predict_root_node(pos);
+    }
     gameNodes.push_back(rootNode);
 }
 
+void MCTSAgent::predict_root_node(Board* pos)
+{
+    DynamicVector<float> policyProbSmall;
+    if (sharedNetBatch != nullptr) {
+        // the search threads are idle, so the slot of the first search thread can be used
+        // the planes are written after activating the slot, because a running prediction might read the planes of inactive slots
+        sharedNetBatch->activate_slot(firstSlotIdx);
+        board_to_planes(pos, 0, true, sharedNetBatch->get_input_planes(firstSlotIdx));
+        sharedNetBatch->predict(firstSlotIdx, 1, valueOutput, probOutputs);
+        // the outputs must be read before the slot is released
+        fill_nn_results(0, sharedNetBatch->is_policy_map(), searchSettings, valueOutput, probOutputs, rootNode, nnCache, policyProbSmall);
+        sharedNetBatch->deactivate_slot(firstSlotIdx);
+        return;
+    }
+    board_to_planes(pos, 0, true, netSingle->get_input_planes());
+    netSingle->predict(1, valueOutput, probOutputs);
+    fill_nn_results(0, netSingle->is_policy_map(), searchSettings, valueOutput, probOutputs, rootNode, nnCache, policyProbSmall);
+}
+
 
 void MCTSAgent::apply_move_to_tree(Move move, bool ownMove)
 {
@@ -216,8 +420,16 @@ void MCTSAgent::apply_move_to_tree(Move move, bool ownMove)
     }
 }
 
+void MCTSAgent::reset_next_roots()
+{
+    ownNextRoot = nullptr;
+    opponentsNextRoot = nullptr;
+}
+
 void MCTSAgent::clear_game_history()
 {
+    // the pending subtrees might still hold hash table entries
+    reclaimer->wait_until_idle();
     for (Node* node: gameNodes) {
         delete node;
     }
@@ -226,19 +438,27 @@ void MCTSAgent::clear_game_history()
     oldestRootNode = nullptr;
     rootNode = nullptr;
     lastValueEval = -1.0f;
+    timeManager->reset_time_bank();
+    // no node references the snapshot anymore
+    delete treeSnapshot;
+    treeSnapshot = nullptr;
 }
 
-#ifdef USE_RL
-void MCTSAgent::export_game_results()
+void MCTSAgent::clear_outdated_nn_cache()
 {
-    int16_t result = gameNodes.back()->get_pos()->side_to_move() == WHITE ? LOSS : WIN;
-    // we set one less than actual plys because the last terminal node isn't part of the training data
-    exporter.export_game_result(result, 0, gameNodes.size()-1);
+    const size_t parameterVersion = sharedNetBatch != nullptr ? sharedNetBatch->get_net()->get_parameter_version() :
+                                                                netSingle->get_parameter_version();
+    if (parameterVersion != nnCacheParameterVersion) {
+        nnCache->clear();
+        nnCacheParameterVersion = parameterVersion;
+        cout << "info string cleared the nn cache after the network parameters changed" << endl;
+    }
 }
-#endif
 
 void MCTSAgent::evalute_board_state(Board *pos, EvalInfo& evalInfo)
 {
+    isTimeManaged = false;
+    clear_outdated_nn_cache();
     size_t nodesPreSearch = init_root_node(pos);
     if (rootNode->get_number_child_nodes() == 1) {
         cout << "info string Only single move available -> early stopping" << endl;
@@ -253,7 +473,7 @@ void MCTSAgent::evalute_board_state(Board *pos, EvalInfo& evalInfo)
         cout << "info string apply dirichlet" << endl;
         rootNode->apply_dirichlet_noise_to_prior_policy();
 
-        if (rootNode->get_parent_node() == nullptr) {
+        if (rootNode->get_parent_node() == nullptr && !reusedFullTree) {
             rootNode->sort_child_nodes_by_probabilities();
         }
         else {
@@ -261,7 +481,12 @@ void MCTSAgent::evalute_board_state(Board *pos, EvalInfo& evalInfo)
             rootNode->mark_as_uncalibrated();
             rootNode->make_to_root();
         }
+        nnCache->reset_statistics();
         run_mcts_search();
+        if (nnCache->is_enabled()) {
+            cout << "info string nn cache hits " << nnCache->get_hits() << " lookups " << nnCache->get_lookups()
+                 << " hit rate " << nnCache->get_hit_rate() << endl;
+        }
     }
 
     evalInfo.childNumberVisits = retrieve_visits(rootNode);
@@ -283,18 +508,40 @@ void MCTSAgent::evalute_board_state(Board *pos, EvalInfo& evalInfo)
     evalInfo.nodesPreSearch = nodesPreSearch;
 }
 
+void MCTSAgent::calibrate_move_overhead(TimePoint bestMoveTime)
+{
+    if (!isTimeManaged || rootNode == nullptr) {
+        return;
+    }
+    isTimeManaged = false;
+    const TimePoint lag = (bestMoveTime - searchLimits->startTime) - (searchStopTime - searchStartTime);
+    timeManager->update_move_overhead(searchLimits, rootNode->get_pos()->side_to_move(), int(lag));
+}
+
+int MCTSAgent::get_move_overhead(const SearchLimits* searchLimits, Color me) const
+{
+    return timeManager->get_move_overhead(searchLimits, me);
+}
+
 void MCTSAgent::run_mcts_search()
 {
     thread** threads = new thread*[searchSettings->threads];
+    searchThreadsStartTime = chrono::steady_clock::now();
     for (size_t i = 0; i < searchSettings->threads; ++i) {
         searchThreads[i]->set_root_node(rootNode);
         searchThreads[i]->set_search_limits(searchLimits);
+        // the flag is already set here to avoid a race with is_search_running()
+        searchThreads[i]->set_is_running(true);
         threads[i] = new thread(go, searchThreads[i]);
     }
     if (searchLimits->nodes == 0) {
         // otherwise will the threads stop by themselves
         stop_search_based_on_limits();
     }
+    else if (searchLimits->movetime != 0) {
+        // the node limit is combined with a hard time limit
+        stop_search_based_on_movetime(searchLimits->movetime);
+    }
     for (size_t i = 0; i < searchSettings->threads; ++i) {
         threads[i]->join();
     }
@@ -310,4 +557,59 @@ void MCTSAgent::print_root_node()
     print_node_statistics(rootNode);
 }
 
+bool MCTSAgent::save_tree(const string& filename)
+{
+    if (rootNode == nullptr) {
+        cout << "info string there is no search tree to save" << endl;
+        return false;
+    }
+    const size_t numberNodes = ::save_tree(rootNode, filename);
+    if (numberNodes == 0) {
+        cout << "info string failed to write the tree to " << filename << endl;
+        return false;
+    }
+    cout << "info string saved " << numberNodes << " nodes to " << filename << endl;
+    return true;
+}
+
+bool MCTSAgent::load_tree(const string& filename, Board* pos)
+{
+    TreeSnapshot* snapshot = new TreeSnapshot();
+    if (!snapshot->open(filename)) {
+        cout << "info string failed to load the tree from " << filename << endl;
+        delete snapshot;
+        return false;
+    }
+    clear_game_history();
+    treeSnapshot = snapshot;
+
+    auto uiThread = make_shared<Thread>(0);
+    pos->set(treeSnapshot->get_fen(), treeSnapshot->is_chess960(), treeSnapshot->get_variant(), new StateInfo, uiThread.get());
+    states->clear_states();
+    states->swap_states();
+    if (pos->hash_key() != treeSnapshot->get_root_key()) {
+        cout << "info string the root position of " << filename << " doesn't match its hash key" << endl;
+        clear_game_history();
+        return false;
+    }
 
+    Board* newPos = new Board(*pos);
+    newPos->setStateInfo(new StateInfo(*(pos->getStateInfo())));
+    rootNode = new Node(newPos, nullptr, MOVE_NONE, searchSettings);
+    oldestRootNode = rootNode;
+    gameNodes.push_back(rootNode);
+    rootNode->expand();
+    rootNode->set_snapshot_record(treeSnapshot, 0);
+    rootNode->restore_from_snapshot();
+    if (!rootNode->has_nn_results()) {
+        cout << "info string the root node of " << filename << " hasn't been evaluated" << endl;
+        clear_game_history();
+        return false;
+    }
+    hashTable->insert({rootNode->hash_key(), rootNode});
+    ownNextRoot = nullptr;
+    opponentsNextRoot = nullptr;
+    cout << "info string loaded the tree with " << rootNode->get_visits() << " visits from " << filename << endl;
+    cout << "info string position " << pos->fen() << endl;
+    return true;
+}
@@ -45,21 +45,32 @@
 #include "../searchthread.h"
 #include "../manager/statesmanager.h"
 #include "../manager/timemanager.h"
+#include "../manager/subtreereclaimer.h"
+#include "../manager/treesnapshot.h"
+
+// interval in ms in which the search limits are checked while the search is running
+const int TIME_CHECK_INTERVAL_MS = 10;
+// portion of the movetime after which the search may be stopped because the best move is already decided
+const float MIN_MOVETIME_PORTION_DECIDED = 0.1f;
 
 class MCTSAgent : public Agent
 {
 private:
     NeuralNetAPI* netSingle;
     NeuralNetAPI** netBatches;
+    // network which is shared with the agents of other games, netSingle and netBatches are unused if it is set
+    SharedNetBatch* sharedNetBatch;
+    // slot of the shared network for the first search thread, the other search threads use the following slots
+    size_t firstSlotIdx;
 
     SearchSettings* searchSettings;
     PlaySettings playSettings;
 
     std::vector<SearchThread*> searchThreads;
 
-    float inputPlanes[NB_VALUES_TOTAL];
-    NDArray* valueOutput;
-    NDArray* probOutputs;
+    // read-only views on the outputs of netSingle
+    const float* valueOutput;
+    const float* probOutputs;
 
     TimeManager* timeManager;
 
@@ -78,12 +89,29 @@ private:
     vector<Node*> gameNodes;
 
     unordered_map<Key, Node*>* hashTable;
+    mutex hashTableMtx;
+    // frees discarded subtrees in the background
+    SubtreeReclaimer* reclaimer;
+    // snapshot of a loaded search tree which is referenced by the nodes that haven't been materialized yet
+    TreeSnapshot* treeSnapshot;
+    // the nn cache isn't bound to the search tree and keeps its entries after clear_game_history()
+    NNCache* nnCache;
+    // parameter version of the network which produced the entries of the nn cache
+    size_t nnCacheParameterVersion;
     StatesManager* states;
     float lastValueEval;
 
     // boolean which indicates if the same node was requested twice for analysis
     bool reusedFullTree;
 
+    // time span in which the search was running according to the time management of the last search
+    TimePoint searchStartTime;
+    TimePoint searchStopTime;
+    // true, if the last search was stopped by the time management
+    bool isTimeManaged;
+    // time at which the search threads of the last search were started
+    chrono::steady_clock::time_point searchThreadsStartTime;
+
     /**
      * @brief reuse_tree Checks if the postion is know and if the tree or parts of the tree can be reused.
      * The old tree or former subtrees will be freed from memory.
@@ -92,6 +120,12 @@ private:
      */
     inline size_t init_root_node(Board* pos);
 
+    /**
+     * @brief clear_outdated_nn_cache Clears the nn cache if the network parameters have been replaced since the cache was filled.
+     * The nodes of the search tree keep their evaluations.
+     */
+    void clear_outdated_nn_cache();
+
     /**
      * @brief get_new_root_node Returns the pointer of the new root node for the given position in the case
      * it was either the old root node or an element of the potential root node list.
@@ -101,6 +135,13 @@ private:
      */
     inline Node* get_root_node_from_tree(Board* pos);
 
+    /**
+     * @brief reclaim_sibling_subtrees Hands the sibling subtrees of the given node over to the reclaimer
+     * after removing the game nodes which lie inside them
+     * @param node Node which stays in the tree
+     */
+    void reclaim_sibling_subtrees(Node* node);
+
     /**
      * @brief stop_search_based_on_limits Checks for the search limit condition and possible early break-ups
      * and stops all running search threads accordingly
@@ -124,12 +165,45 @@ private:
      */
     inline bool continue_search();
 
+    /**
+     * @brief is_best_move_decided Checks if the most visited root child can still be overtaken by the second most visited one
+     * within the remaining time, assuming that the nodes per second stay the same as so far in the current search.
+     * @param elapsedTime Elapsed search time in ms
+     * @param curMovetime Planned movetime in ms
+     * @param visitsPreSearch Number of visits of the root node before the search started
+     * @return True, if the move can't change anymore and the search can be stopped
+     */
+    inline bool is_best_move_decided(TimePoint elapsedTime, int curMovetime, float visitsPreSearch);
+
+    /**
+     * @brief stop_search_based_on_movetime Waits until all search threads reached the node limit
+     * or stops them after the given movetime at the latest
+     * @param movetime Maximum search time in ms
+     */
+    inline void stop_search_based_on_movetime(TimePoint movetime);
+
+    /**
+     * @brief is_search_running Returns true if any search thread is still running
+     */
+    inline bool is_search_running() const;
+
     /**
      * @brief create_new_root_node Creates a new root node for the given board position and requests the neural network for evaluation
      * @param pos Board position
      */
     inline void create_new_root_node(Board *pos);
 
+    /**
+     * @brief init_search_structures Allocates the hash table, caches and managers which are used by all constructors
+     */
+    void init_search_structures();
+
+    /**
+     * @brief predict_root_node Requests the neural network for the given root node
+     * @param pos Board position of the root node
+     */
+    inline void predict_root_node(Board* pos);
+
 public:
     MCTSAgent(NeuralNetAPI* netSingle,
               NeuralNetAPI** netBatches,
@@ -137,6 +211,21 @@ public:
               PlaySettings playSettings,
               StatesManager* states);
 
+    /**
+     * @brief MCTSAgent Constructor for an agent which evaluates its positions together with the agents of other games.
+     * Every search thread of the agent uses a separate slot of the shared network.
+     * @param sharedNetBatch Shared network with at least firstSlotIdx + searchSettings->threads slots
+     * @param firstSlotIdx Slot of the first search thread
+     * @param searchSettings Settings which are owned by the agent
+     * @param playSettings Play settings
+     * @param states States manager of the agent
+     */
+    MCTSAgent(SharedNetBatch* sharedNetBatch,
+              size_t firstSlotIdx,
+              SearchSettings* searchSettings,
+              PlaySettings playSettings,
+              StatesManager* states);
+
     ~MCTSAgent();
 
     void evalute_board_state(Board *pos, EvalInfo& evalInfo);
@@ -160,18 +249,83 @@ public:
      */
     void apply_move_to_tree(Move move, bool ownMove);
 
+    /**
+     * @brief reset_next_roots Discards the candidates for the next root node, e.g. when a move has been played without searching the tree.
+     * The next search can still reuse a subtree, because the path from the root node is verified against the position history.
+     */
+    void reset_next_roots();
+
     /**
      * @brief clear_game_history Traverses all root positions for the game and calls clear_subtree() for each of them
      */
     void clear_game_history();
 
-#ifdef USE_RL
-    void export_game_results();
-#endif
-
     Node *get_opponents_next_root() const;
 
     Node* get_root_node() const;
+
+    /**
+     * @brief get_nn_statistics Returns how many positions the search threads have sent to the neural network
+     * and how many positions the sent mini-batches could have held since the agent was created.
+     * The single root predictions aren't included.
+     * If the agent uses a shared network, the statistics of its actual batches are returned instead. These include the predictions
+     * of all agents which share the network and their root predictions.
+     * @param evaluatedNodes Number of evaluated positions
+     * @param batchCapacity Number of mini-batches times the batch size
+     */
+    void get_nn_statistics(size_t& evaluatedNodes, size_t& batchCapacity) const;
+
+    /**
+     * @brief uses_shared_net_batch Returns true, if the agent evaluates its positions together with the agents of other games
+     */
+    bool uses_shared_net_batch() const;
+
+    /**
+     * @brief get_collision_statistics Returns how many leaf nodes the search threads have selected since the agent was created
+     * and how many of these selections were collisions with a node which was already waiting for its evaluation
+     * @param selections Number of selected leaf nodes
+     * @param collisions Number of collisions
+     */
+    void get_collision_statistics(size_t& selections, size_t& collisions) const;
+
+    /**
+     * @brief get_time_to_first_batch Returns the time between the start of the search threads of the last search
+     * and the first returned mini-batch prediction
+     * @return Time in ms or -1 if no mini-batch has been evaluated in the last search
+     */
+    double get_time_to_first_batch() const;
+
+    /**
+     * @brief calibrate_move_overhead Measures the lag of the last search, i.e. all time since the go command which wasn't
+     * planned as search time by the time manager, and passes it to the time manager to calibrate the move overhead.
+     * It must be called after the bestmove has been sent and before the move is applied to the tree.
+     * @param bestMoveTime Time point at which the bestmove was sent
+     */
+    void calibrate_move_overhead(TimePoint bestMoveTime);
+
+    /**
+     * @brief get_move_overhead Returns the move overhead which the time manager currently applies for the given search limits
+     * @param searchLimits Limits of the current search
+     * @param me Side to move
+     * @return Move overhead in ms
+     */
+    int get_move_overhead(const SearchLimits* searchLimits, Color me) const;
+
+    /**
+     * @brief save_tree Stores the current search tree below the root node in the given file
+     * @param filename Output file
+     * @return True on success
+     */
+    bool save_tree(const string& filename);
+
+    /**
+     * @brief load_tree Replaces the current search tree with the tree of the given file and sets the position to its root position.
+     * The file is memory mapped and the nodes are only created when the search reaches them.
+     * @param filename File which has been written by save_tree()
+     * @param pos Board position which will be set to the root position of the loaded tree
+     * @return True on success
+     */
+    bool load_tree(const string& filename, Board* pos);
 };
 
 #endif // MCTSAGENT_H
@@ -39,11 +39,14 @@ RawNetAgent::RawNetAgent(NeuralNetAPI *net, PlaySettings playSettings, float tem
 {
     this->net = net;
     this->playSettings = playSettings;
-    fill(inputPlanes, inputPlanes+NB_VALUES_TOTAL, 0.0f);  // will be filled in evalute_board_state()
+    valueOutput = nullptr;
+    probOutputs = nullptr;
 }
 
 void RawNetAgent::evalute_board_state(Board *pos, EvalInfo& evalInfo)
 {
+    // the evalInfo object might be reused from a previous search
+    evalInfo.legalMoves.clear();
     for (const ExtMove& move : MoveList<LEGAL>(*pos)) {
         evalInfo.legalMoves.push_back(move);
     }
@@ -62,30 +65,17 @@ void RawNetAgent::evalute_board_state(Board *pos, EvalInfo& evalInfo)
         evalInfo.pv = {evalInfo.legalMoves[0]};
     }
 
-    board_to_planes(pos, 0, true, begin(inputPlanes));
-    float value;
-
-    NDArray probOutputs = net->predict(begin(inputPlanes), value);
-    auto predicted = probOutputs.ArgmaxChannel();
-    predicted.WaitToRead();
-
-    int bestIdx = predicted.At(0, 0);
-
-    string bestmove_mxnet;
-    if (pos->side_to_move() == WHITE) {
-        bestmove_mxnet = LABELS[bestIdx];
-    }
-    else {
-        bestmove_mxnet = LABELS_MIRRORED[bestIdx];
-    }
+    board_to_planes(pos, 0, true, net->get_input_planes());
+    net->predict(1, valueOutput, probOutputs);
+    const float value = valueOutput[0];
 
+    // only the entries of the legal moves are read from the policy output
     evalInfo.policyProbSmall.resize(evalInfo.legalMoves.size());
-    get_probs_of_move_list(0, &probOutputs, evalInfo.legalMoves, pos->side_to_move(),
+    get_probs_of_move_list(0, probOutputs, evalInfo.legalMoves, pos->side_to_move(),
                            !net->is_policy_map(), evalInfo.policyProbSmall, net->is_policy_map());
     size_t sel_idx = argmax(evalInfo.policyProbSmall);
 
     Move bestmove = evalInfo.legalMoves[sel_idx];
-    assert(bestmove_mxnet == UCI::move(bestmove, pos->is_chess960()));
 
     evalInfo.centipawns = value_to_centipawn(value);
     evalInfo.depth = 1;
@@ -45,9 +45,9 @@ class RawNetAgent: public Agent
 private:
     NeuralNetAPI *net;
     PlaySettings playSettings;
-    float inputPlanes[NB_VALUES_TOTAL];
-    NDArray valueOutput = NDArray(Shape(1, 1), Context::cpu());
-    NDArray probOutputs = NDArray(Shape(1, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH), Context::cpu());
+    // read-only views on the outputs of net
+    const float* valueOutput;
+    const float* probOutputs;
 
 public:
     RawNetAgent(NeuralNetAPI *net, PlaySettings playSettings,
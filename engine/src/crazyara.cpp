@@ -24,6 +24,8 @@
  */
 
 #include "crazyara.h"
+#include <fstream>
+#include <cctype>
 
 #include "bitboard.h"
 #include "position.h"
@@ -42,21 +44,23 @@
 #include "domain/variants.h"
 #include "optionsuci.h"
 #include "tests/benchmarkpositions.h"
+#include "tests/benchmarkreport.h"
 
 using namespace std;
 
 // allocate memory
 string LABELS_MIRRORED[NB_LABELS];
-unordered_map<Move, size_t> MV_LOOKUP = {};
-unordered_map<Move, size_t> MV_LOOKUP_MIRRORED = {};
-unordered_map<Move, size_t> MV_LOOKUP_CLASSIC = {};
-unordered_map<Move, size_t> MV_LOOKUP_MIRRORED_CLASSIC = {};
+vector<uint16_t> MV_LOOKUP = {};
+vector<uint16_t> MV_LOOKUP_MIRRORED = {};
+vector<uint16_t> MV_LOOKUP_CLASSIC = {};
+vector<uint16_t> MV_LOOKUP_MIRRORED_CLASSIC = {};
 
 CrazyAra::CrazyAra()
 {
     searchSettings = nullptr;  // will be initialized in init_search_settings()
     playSettings = nullptr;    // will be initialized in init_play_settings()
     netSingle = nullptr;       // will be initialized in is_ready()
+    modelReloader = nullptr;   // will be initialized in is_ready()
     states = new StatesManager();
 }
 
@@ -66,8 +70,9 @@ void CrazyAra::welcome()
     cout << intro << endl;
 }
 
-void CrazyAra::uci_loop(int argc, char *argv[])
+int CrazyAra::uci_loop(int argc, char *argv[])
 {
+    int exitCode = 0;
     Board pos;
     string token, cmd;
     EvalInfo evalInfo;
@@ -130,10 +135,14 @@ void CrazyAra::uci_loop(int argc, char *argv[])
         }
 
         // Additional custom non-UCI commands, mainly for debugging
-        else if (token == "benchmark")  benchmark(is);
+        else if (token == "benchmark")  exitCode = benchmark(is) ? 0 : 1;
         else if (token == "root")       mctsAgent->print_root_node();
         else if (token == "flip")       pos.flip();
         else if (token == "d")          cout << pos << endl;
+        else if (token == "savetree")   save_tree(is);
+        else if (token == "loadtree")   load_tree(&pos, is);
+        else if (token == "match")      match(is);
+        else if (token == "reloadmodel") reload_model(is);
 #ifdef USE_RL
         else if (token == "selfplay")   selfplay(is, pos);
 #endif
@@ -142,11 +151,13 @@ void CrazyAra::uci_loop(int argc, char *argv[])
 
         ++it;
     } while (token != "quit" && argc == 1); // Command line args are one-shot
+    return exitCode;
 }
 
 void CrazyAra::go(Board *pos, istringstream &is,  EvalInfo& evalInfo, bool applyMoveToTree) {
     SearchLimits searchLimits;
     searchLimits.moveOverhead = TimePoint(Options["Move_Overhead"]);
+    searchLimits.adaptiveMoveOverhead = Options["Adaptive_Move_Overhead"];
     searchLimits.nodes = Options["Nodes"];
 
     string token;
@@ -168,9 +179,35 @@ void CrazyAra::go(Board *pos, istringstream &is,  EvalInfo& evalInfo, bool apply
         else if (token == "infinite")  searchLimits.infinite = true;
         else if (token == "ponder")    ponderMode = true;
     }
-    //  EvalInfo res = rawAgent->evalute_board_state(pos);
-    //  rawAgent->perform_action(pos);
+    if (Options["Use_Raw_Network"]) {
+        rawAgent->perform_action(pos, &searchLimits, evalInfo);
+        // the move wasn't played from the root node of the search tree
+        mctsAgent->reset_next_roots();
+        return;
+    }
+
+    const Color me = pos->side_to_move();
+    const bool isEmergency = is_emergency(me, searchLimits);
+    if (isEmergency) {
+        const int emergencyMoveTime = get_emergency_move_time(me, searchLimits);
+        if (string(Options["Emergency_Mode"]) == "raw") {
+            cout << "info string emergency mode with the raw network, time bound " << emergencyMoveTime << "ms" << endl;
+            rawAgent->perform_action(pos, &searchLimits, evalInfo);
+            mctsAgent->reset_next_roots();
+            return;
+        }
+        // run a micro search with a fixed number of nodes which is stopped at the latest after the remaining time bound
+        const int lag = mctsAgent->get_move_overhead(&searchLimits, me);
+        searchLimits.nodes = Options["Emergency_Nodes"];
+        searchLimits.movetime = max(emergencyMoveTime - lag, 1);
+        cout << "info string emergency mode with " << searchLimits.nodes << " nodes, time bound " << emergencyMoveTime
+             << "ms, measured lag " << lag << "ms" << endl;
+    }
     mctsAgent->perform_action(pos, &searchLimits, evalInfo);
+    if (!isEmergency) {
+        // the delay until the bestmove has been sent is used to calibrate the move overhead
+        mctsAgent->calibrate_move_overhead(now());
+    }
 
     if (applyMoveToTree) {
         // inform the mcts agent of the move, so the tree can potentially be reused later
@@ -233,55 +270,296 @@ void CrazyAra::position(Board *pos, istringstream& is) {
     cout << "info string position " << pos->fen() << endl;
 }
 
-void CrazyAra::benchmark(istringstream &is)
+void CrazyAra::save_tree(istringstream& is)
+{
+    string filename;
+    is >> filename;
+    if (filename.empty()) {
+        cout << "info string usage: savetree <file>" << endl;
+        return;
+    }
+    if (is_ready()) {
+        mctsAgent->save_tree(filename);
+    }
+}
+
+void CrazyAra::load_tree(Board* pos, istringstream& is)
+{
+    string filename;
+    is >> filename;
+    if (filename.empty()) {
+        cout << "info string usage: loadtree <file>" << endl;
+        return;
+    }
+    if (is_ready()) {
+        mctsAgent->load_tree(filename, pos);
+    }
+}
+
+bool CrazyAra::benchmark(istringstream &is)
 {
-    int passedCounter = 0;
-    EvalInfo evalInfo;
     BenchmarkPositions benchmark;
-    string moveTime;
-    is >> moveTime;
-    string goCommand = "go movetime " + moveTime;
-    int totalNPS = 0;
-    int totalDepth = 0;
+    string goCommand = "go";
+    string token;
+    string jsonFileName;
+    string baselineFileName;
+    int moveTime = 0;
+    int nodes = 0;
+    float threshold = BENCHMARK_DEFAULT_THRESHOLD;
 
-    for (TestPosition pos : benchmark.positions) {
-        go(pos.fen, goCommand, evalInfo);
-        string uciMove = UCI::move(evalInfo.bestMove, false);
-        if (uciMove != pos.blunderMove) {
-            cout << "passed      -- " << uciMove << " != " << pos.blunderMove << endl;
-            passedCounter++;
-        }
-        else {
-            cout << "failed      -- " << uciMove << " == " << pos.blunderMove << endl;
-        }
-        cout << "alternative -- ";
-        if (uciMove == pos.alternativeMove) {
-            cout << uciMove << " == " << pos.alternativeMove << endl;
+    while (is >> token) {
+        if (token == "movetime")       is >> moveTime;
+        else if (token == "nodes")     is >> nodes;
+        else if (token == "epd") {
+            string epdFileName;
+            is >> epdFileName;
+            if (!benchmark.load_epd(epdFileName)) {
+                return false;
+            }
         }
-        else {
-            cout << uciMove << " != " << pos.alternativeMove << endl;
+        else if (token == "json")      is >> jsonFileName;
+        else if (token == "baseline")  is >> baselineFileName;
+        else if (token == "threshold") is >> threshold;
+        else if (isdigit(token[0]))    moveTime = stoi(token);  // legacy syntax: benchmark <movetime>
+    }
+    if (moveTime == 0 && nodes == 0) {
+        cout << "info string usage: benchmark [movetime <ms>] [nodes <n>] [epd <file>] [json <file>] [baseline <file>] [threshold <percent>]" << endl;
+        return false;
+    }
+    if (moveTime != 0) {
+        goCommand += " movetime " + to_string(moveTime);
+    }
+    if (nodes != 0) {
+        goCommand += " nodes " + to_string(nodes);
+    }
+    if (!is_ready()) {
+        return false;
+    }
+
+    EvalInfo evalInfo;
+    vector<PositionBenchmark> results;
+    for (const TestPosition& pos : benchmark.positions) {
+        // every position starts with an empty tree, so that the measurements don't depend on the order of the positions
+        mctsAgent->clear_game_history();
+        size_t evaluatedNodesPre, batchCapacityPre, selectionsPre, collisionsPre;
+        mctsAgent->get_nn_statistics(evaluatedNodesPre, batchCapacityPre);
+        mctsAgent->get_collision_statistics(selectionsPre, collisionsPre);
+
+        go(pos.fen, goCommand, evalInfo);
+
+        size_t evaluatedNodes, batchCapacity, selections, collisions;
+        mctsAgent->get_nn_statistics(evaluatedNodes, batchCapacity);
+        mctsAgent->get_collision_statistics(selections, collisions);
+        PositionBenchmark result;
+        result.fen = pos.fen;
+        result.bestMove = UCI::move(evalInfo.bestMove, false);
+        result.blunderMove = pos.blunderMove;
+        result.nodes = evalInfo.nodes;
+        result.nps = evalInfo.nps;
+        result.depth = evalInfo.depth;
+        result.elapsedTimeMS = evalInfo.elapsedTimeMS;
+        result.treeMemory = get_tree_memory(mctsAgent->get_root_node());
+        result.batchFill = batchCapacity == batchCapacityPre ? 0 : float(evaluatedNodes - evaluatedNodesPre) / (batchCapacity - batchCapacityPre);
+        result.collisionRatio = selections == selectionsPre ? 0 : float(collisions - collisionsPre) / (selections - selectionsPre);
+        result.timeToFirstBatchMS = mctsAgent->get_time_to_first_batch();
+        results.push_back(result);
+
+        if (!pos.blunderMove.empty()) {
+            cout << (result.is_passed() ? "passed      -- " : "failed      -- ") << result.bestMove
+                 << (result.is_passed() ? " != " : " == ") << pos.blunderMove << endl;
         }
-        totalNPS += evalInfo.nps;
-        totalDepth += evalInfo.depth;
     }
 
+    nlohmann::json settings;
+    settings["version"] = version;
+    settings["variant"] = string(Options["UCI_Variant"]);
+    settings["context"] = string(Options["Context"]);
+    settings["threads"] = searchSettings->threads;
+    settings["batch_size"] = searchSettings->batchSize;
+    settings["go"] = goCommand;
+    settings["number_positions"] = benchmark.positions.size();
+    const nlohmann::json report = create_benchmark_report(results, settings);
+
     cout << endl << "Summary" << endl;
     cout << "----------------------" << endl;
-    cout << "Passed:\t\t" << passedCounter << "/" << benchmark.positions.size() << endl;
-    cout << "NPS:\t\t" << setw(2) << totalNPS /  benchmark.positions.size() << endl;
-    cout << "PV-Depth:\t" << setw(2) << totalDepth /  benchmark.positions.size() << endl;
+    cout << "Passed:\t\t" << report["summary"]["passed"] << "/" << results.size() << endl;
+    cout << "NPS:\t\t" << report["summary"]["nps"] << endl;
+    cout << "PV-Depth:\t" << report["summary"]["depth"] << endl;
+    cout << "Batch fill:\t" << report["summary"]["batch_fill"] << endl;
+    cout << "Collisions:\t" << report["summary"]["collision_ratio"] << endl;
+
+    if (jsonFileName.empty()) {
+        cout << report.dump(4) << endl;
+    }
+    else {
+        ofstream jsonFile(jsonFileName);
+        jsonFile << report.dump(4) << endl;
+        cout << "info string wrote the benchmark report to " << jsonFileName << endl;
+    }
+
+    if (baselineFileName.empty()) {
+        return true;
+    }
+    ifstream baselineFile(baselineFileName);
+    if (!baselineFile.is_open()) {
+        cout << "info string failed to open the baseline " << baselineFileName << endl;
+        return false;
+    }
+    nlohmann::json baseline;
+    try {
+        baselineFile >> baseline;
+    }
+    catch (const nlohmann::json::exception& e) {
+        cout << "info string failed to parse the baseline " << baselineFileName << ": " << e.what() << endl;
+        return false;
+    }
+    return compare_to_baseline(report, baseline, threshold);
+}
+
+void CrazyAra::match(istringstream& is)
+{
+    string modelDirectories[2];
+    is >> modelDirectories[0] >> modelDirectories[1];
+    size_t numberGames = 2;
+    size_t concurrentGames = 1;
+    string openingFile;
+    SearchLimits searchLimits;
+    string token;
+    while (is >> token) {
+        if (token == "games")             is >> numberGames;
+        else if (token == "nodes")        is >> searchLimits.nodes;
+        else if (token == "movetime")     is >> searchLimits.movetime;
+        else if (token == "openings")     is >> openingFile;
+        else if (token == "concurrency")  is >> concurrentGames;
+    }
+    if (modelDirectories[1].empty() || (searchLimits.nodes == 0 && searchLimits.movetime == 0) || concurrentGames == 0) {
+        cout << "info string usage: match <modelDirectoryA> <modelDirectoryB> [games <n>] [nodes <n> | movetime <ms>] [openings <file>] [concurrency <n>]" << endl;
+        return;
+    }
+    if (!networkLoaded) {
+        init_search_settings();
+        init_play_settings();
+    }
+    const Variant variant = UCI::variant_from_name(Options["UCI_Variant"]);
+    const vector<string> openings = openingFile.empty() ? vector<string>() : load_openings(openingFile);
+
+    // the agents of all concurrent games which use the same network evaluate their positions together
+    SharedNetBatch* sharedNetBatches[2];
+    vector<MCTSAgent*> agents[2];
+    vector<StatesManager*> agentStates;
+    for (size_t netIdx = 0; netIdx < 2; ++netIdx) {
+        sharedNetBatches[netIdx] = new SharedNetBatch(Options["Context"], concurrentGames * searchSettings->threads, searchSettings->batchSize,
+                                                      modelDirectories[netIdx], Options["Use_TensorRT"]);
+        for (size_t gameIdx = 0; gameIdx < concurrentGames; ++gameIdx) {
+            SearchSettings* agentSearchSettings = new SearchSettings(*searchSettings);
+            agentSearchSettings->nnCacheSize = searchSettings->nnCacheSize / (2 * concurrentGames);
+            agentStates.push_back(new StatesManager());
+            agents[netIdx].push_back(new MCTSAgent(sharedNetBatches[netIdx], gameIdx * searchSettings->threads, agentSearchSettings, *playSettings, agentStates.back()));
+        }
+    }
+
+    // the move look-up tables depend on the policy representation and are shared by both networks
+    if (sharedNetBatches[0]->is_policy_map() == sharedNetBatches[1]->is_policy_map()) {
+        Constants::init(sharedNetBatches[0]->is_policy_map());
+        cout << "info string play " << numberGames << " games with " << concurrentGames << " concurrent games" << endl;
+        Match match(agents[0], agents[1], openings, variant);
+        const MatchResult result = match.go(numberGames, searchLimits);
+        float elo;
+        float eloError;
+        compute_elo(result, elo, eloError);
+        cout << "info string match result " << modelDirectories[0] << " vs " << modelDirectories[1]
+             << " W " << result.wins << " D " << result.draws << " L " << result.losses
+             << " elo " << elo << " +/- " << eloError << endl;
+    }
+    else {
+        cout << "info string the networks must use the same policy representation" << endl;
+    }
+
+    for (size_t netIdx = 0; netIdx < 2; ++netIdx) {
+        for (MCTSAgent* agent : agents[netIdx]) {
+            delete agent;
+        }
+        delete sharedNetBatches[netIdx];
+    }
+    for (StatesManager* states : agentStates) {
+        delete states;
+    }
+    if (networkLoaded) {
+        Constants::init(netSingle->is_policy_map());
+    }
+}
+
+void CrazyAra::reload_model(istringstream& is)
+{
+    string modelDirectory;
+    is >> modelDirectory;
+    if (modelDirectory.empty()) {
+        modelDirectory = string(Options["Model_Directory"]);
+    }
+    else {
+        // networks which are created later, e.g. for self play with parallel games, use the new model as well
+        Options["Model_Directory"] = modelDirectory;
+    }
+    if (is_ready()) {
+        modelReloader->reload_async(modelDirectory);
+    }
 }
 
 #ifdef USE_RL
 void CrazyAra::selfplay(istringstream &is, Board& pos)
 {
-    selfPlay = new SelfPlay(mctsAgent);
     SearchLimits searchLimits;
     searchLimits.nodes = Options["Nodes"];
 
     size_t numberOfGames;
     is >> numberOfGames;
-    selfPlay->go(numberOfGames, searchLimits);
+
+    // every process writes its own shard, so that several self play processes can run side by side
+    string shardId = Options["Shard_Id"];
+    if (shardId == "auto") {
+        shardId = get_process_shard_id();
+    }
+    cout << "info string export to shard " << shardId << endl;
+
+    RLSettings rlSettings;
+    rlSettings.fastNodes = Options["Fast_Nodes"];
+    rlSettings.fullSearchProb = Options["Centi_Full_Search_Prob"] / 100.0f;
+    rlSettings.resignThreshold = Options["Centi_Resign_Threshold"] / 100.0f;
+    rlSettings.resignPlayoutProb = Options["Centi_Resign_Playout"] / 100.0f;
+
+    const size_t parallelGames = Options["Parallel_Games"];
+    if (parallelGames == 1) {
+        SelfPlay selfPlay({mctsAgent}, rlSettings, shardId, Options["Compact_Train_Data"], Options["Metrics_Interval"]);
+        selfPlay.go(numberOfGames, searchLimits);
+        return;
+    }
+
+    // every search thread of every game writes its mini-batch into its own slot of one shared network
+    SharedNetBatch* sharedNetBatch = new SharedNetBatch(Options["Context"], parallelGames * searchSettings->threads, searchSettings->batchSize,
+                                                        Options["Model_Directory"], Options["Use_TensorRT"]);
+    vector<MCTSAgent*> mctsAgents;
+    vector<StatesManager*> agentStates;
+    for (size_t gameIdx = 0; gameIdx < parallelGames; ++gameIdx) {
+        SearchSettings* agentSearchSettings = new SearchSettings(*searchSettings);
+        // the total memory of the nn caches stays the same as for a single game
+        agentSearchSettings->nnCacheSize = searchSettings->nnCacheSize / parallelGames;
+        agentStates.push_back(new StatesManager());
+        mctsAgents.push_back(new MCTSAgent(sharedNetBatch, gameIdx * searchSettings->threads, agentSearchSettings, *playSettings, agentStates.back()));
+    }
+    cout << "info string play " << parallelGames << " games in parallel" << endl;
+    // the shared network is only known during self play, so it gets its own watcher
+    ModelReloader sharedNetReloader({sharedNetBatch->get_net()}, Options["Model_Directory"]);
+    if (int(Options["Model_Watch_Interval"]) > 0) {
+        sharedNetReloader.watch(Options["Model_Watch_Interval"]);
+    }
+    SelfPlay selfPlay(mctsAgents, rlSettings, shardId, Options["Compact_Train_Data"], Options["Metrics_Interval"]);
+    selfPlay.go(numberOfGames, searchLimits);
+
+    for (size_t gameIdx = 0; gameIdx < parallelGames; ++gameIdx) {
+        delete mctsAgents[gameIdx];
+        delete agentStates[gameIdx];
+    }
+    delete sharedNetBatch;
 }
 #endif
 
@@ -308,6 +586,12 @@ bool CrazyAra::is_ready()
         }
         Constants::init(netSingle->is_policy_map());
         mctsAgent = new MCTSAgent(netSingle, netBatches, searchSettings, *playSettings, states);
+        vector<NeuralNetAPI*> nets = {netSingle};
+        nets.insert(nets.end(), netBatches, netBatches + searchSettings->threads);
+        modelReloader = new ModelReloader(nets, modelDirectory);
+        if (int(Options["Model_Watch_Interval"]) > 0) {
+            modelReloader->watch(Options["Model_Watch_Interval"]);
+        }
         networkLoaded = true;
     }
     return networkLoaded;
@@ -319,6 +603,21 @@ void CrazyAra::new_game()
     cout << "info string newgame" << endl;
 }
 
+bool CrazyAra::is_emergency(Color me, const SearchLimits& searchLimits)
+{
+    const int emergencyTime = Options["Emergency_Time"];
+    if (emergencyTime == 0 || searchLimits.movetime != 0 || searchLimits.nodes != 0 || searchLimits.time[me] == 0) {
+        return false;
+    }
+    const int threshold = max(emergencyTime, EMERGENCY_OVERHEAD_FACTOR * mctsAgent->get_move_overhead(&searchLimits, me));
+    return searchLimits.time[me] < threshold;
+}
+
+int CrazyAra::get_emergency_move_time(Color me, const SearchLimits& searchLimits)
+{
+    return max(min(int(Options["Emergency_Move_Time"]), searchLimits.time[me] / EMERGENCY_TIME_DIVISOR), 1);
+}
+
 string CrazyAra::engine_info()
 {
     stringstream ss;
@@ -349,6 +648,7 @@ void CrazyAra::init_search_settings()
     searchSettings->qThreshMax = Options["Centi_Q_Thresh_Max"] / 100.0f;
     searchSettings->qThreshBase = Options["Q_Thresh_Base"];
     searchSettings->randomMoveFactor = Options["Centi_Random_Move_Factor"]  / 100.0f;
+    searchSettings->nnCacheSize = Options["NN_Cache_Size"];
 }
 
 void CrazyAra::init_play_settings()
@@ -33,15 +33,22 @@
 #include "agents/rawnetagent.h"
 #include "agents/mctsagent.h"
 #include "nn/neuralnetapi.h"
+#include "nn/modelreloader.h"
 #include "agents/config/searchsettings.h"
 #include "agents/config/searchlimits.h"
 #include "agents/config/playsettings.h"
 #include "node.h"
 #include "manager/statesmanager.h"
+#include "rl/match.h"
 #ifdef USE_RL
 #include "rl/selfplay.h"
 #endif
 
+// the emergency mode is also active if the remaining time can't cover the measured move overhead this many times
+const int EMERGENCY_OVERHEAD_FACTOR = 20;
+// the emergency mode never uses more than this fraction of the remaining time for a single move
+const int EMERGENCY_TIME_DIVISOR = 20;
+
 class CrazyAra
 {
 private:
@@ -71,20 +78,36 @@ private:
     RawNetAgent* rawAgent;
     MCTSAgent* mctsAgent;
     NeuralNetAPI* netSingle;
+    // replaces the parameters of netSingle and the batch networks of mctsAgent
+    ModelReloader* modelReloader;
     SearchSettings* searchSettings;
     PlaySettings* playSettings;
     bool networkLoaded = false;
     StatesManager* states;
 
-#ifdef USE_RL
-    SelfPlay* selfPlay;
-#endif
     /**
      * @brief engine_info Returns a string about the engine version and authors
      * @return string
      */
     string engine_info();
 
+    /**
+     * @brief is_emergency Checks if the remaining time is too low for a regular search.
+     * This is the case if it falls below the Emergency_Time option or can't cover the measured move overhead often enough.
+     * @param me Side to move
+     * @param searchLimits Limits of the current search
+     * @return True, if the emergency mode shall be used
+     */
+    bool is_emergency(Color me, const SearchLimits& searchLimits);
+
+    /**
+     * @brief get_emergency_move_time Returns the hard time bound in ms until the bestmove must be sent in the emergency mode
+     * @param me Side to move
+     * @param searchLimits Limits of the current search
+     * @return Time bound in ms
+     */
+    int get_emergency_move_time(Color me, const SearchLimits& searchLimits);
+
 public:
     CrazyAra();
 
@@ -97,8 +120,9 @@ public:
      * @brief uci_loop Runs the uci-loop which reads std-in UCI-messages
      * @param argc Number of arguments
      * @param argv Argument values
+     * @return Exit code of the process, it is non-zero if the last benchmark failed or regressed
      */
-    void uci_loop(int argc, char* argv[]);
+    int uci_loop(int argc, char* argv[]);
 
     /**
      * @brief init Initializes all needed backend-types
@@ -142,10 +166,43 @@ public:
     void position(Board* pos, istringstream& is);
 
     /**
-     * @brief benchmark Runs a list of benchmark position for a given time
-     * @param is Movetime in ms
+     * @brief save_tree Stores the search tree of the last search in the given file
+     * @param is Filename
+     */
+    void save_tree(istringstream& is);
+
+    /**
+     * @brief load_tree Loads a search tree which has been stored by save_tree() and sets the position to its root position.
+     * The tree is reused by the next search if the position isn't changed.
+     * @param pos Position object which will be set
+     * @param is Filename
+     */
+    void load_tree(Board* pos, istringstream& is);
+
+    /**
+     * @brief benchmark Runs a list of benchmark positions and reports the measurements of every position as json.
+     * Syntax: benchmark [movetime <ms>] [nodes <n>] [epd <file>] [json <file>] [baseline <file>] [threshold <percent>]
+     * The positions are taken from BenchmarkPositions unless an EPD file is given. If a baseline report is given,
+     * the average NPS must not be more than threshold percent lower than the one of the baseline.
+     * @param is Arguments of the benchmark command
+     * @return False, if the benchmark couldn't be run or regressed compared to the baseline
+     */
+    bool benchmark(istringstream& is);
+
+    /**
+     * @brief match Plays a match between two networks within this process and reports the result and Elo difference.
+     * Syntax: match <modelDirectoryA> <modelDirectoryB> [games <n>] [nodes <n> | movetime <ms>] [openings <file>] [concurrency <n>]
+     * @param is Arguments of the match command
+     */
+    void match(istringstream& is);
+
+    /**
+     * @brief reload_model Loads the parameters of a model directory in the background and swaps them into the loaded networks.
+     * The search tree is kept and a running search continues with the new parameters.
+     * Syntax: reloadmodel [modelDirectory], the directory defaults to the Model_Directory option
+     * @param is Arguments of the reloadmodel command
      */
-    void benchmark(istringstream& is);
+    void reload_model(istringstream& is);
 
 #ifdef USE_RL
     /**
@@ -36,6 +36,8 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
+#include <algorithm>
 #include "types.h"
 #include "../../util/sfutil.h"
 #include <iostream>
@@ -102,6 +104,39 @@ const std::unordered_map<Variant, int> CHANNEL_MAPPING_VARIANTS = {
     {HORDE_VARIANT, 7},
     {RACE_VARIANT, 8}
 };
+
+/**
+ * @brief get_variant_channel Returns the offset of the one-hot variant channel, which is the same as in CHANNEL_MAPPING_VARIANTS.
+ * This version can be evaluated at compile time and is used by the variant specialized input representation.
+ * @param variant Active variant
+ * @return Channel offset relative to the is960 channel
+ */
+constexpr int get_variant_channel(Variant variant)
+{
+    return
+        #ifdef CRAZYHOUSE
+        variant == CRAZYHOUSE_VARIANT ? 2 :
+        #endif
+        #ifdef KOTH
+        variant == KOTH_VARIANT ? 3 :
+        #endif
+        #ifdef THREECHECK
+        variant == THREECHECK_VARIANT ? 4 :
+        #endif
+        #ifdef ANTI
+        variant == ANTI_VARIANT ? 5 :
+        #endif
+        #ifdef ATOMIC
+        variant == ATOMIC_VARIANT ? 6 :
+        #endif
+        #ifdef HORDE
+        variant == HORDE_VARIANT ? 7 :
+        #endif
+        #ifdef RACE
+        variant == RACE_VARIANT ? 8 :
+        #endif
+        1;
+}
 #endif
 const int NB_LABELS_POLICY_MAP = NB_CHANNELS_POLICY_MAP * BOARD_HEIGHT * BOARD_WIDTH;
 
@@ -4708,31 +4743,70 @@ const std::string LABELS[] = {
 
 // will be filled in init()
 // stores a mapping from Stockfish's move representation to the NN index in the policy
-extern std::unordered_map<Move, size_t> MV_LOOKUP;
-extern std::unordered_map<Move, size_t> MV_LOOKUP_MIRRORED;
+// the tables are directly indexed by the integer value of the move, unknown moves map to index 0
+extern std::vector<uint16_t> MV_LOOKUP;
+extern std::vector<uint16_t> MV_LOOKUP_MIRRORED;
 
 // classical look up tables, which are later used for policy export
-extern std::unordered_map<Move, size_t> MV_LOOKUP_CLASSIC;
-extern std::unordered_map<Move, size_t> MV_LOOKUP_MIRRORED_CLASSIC;
+extern std::vector<uint16_t> MV_LOOKUP_CLASSIC;
+extern std::vector<uint16_t> MV_LOOKUP_MIRRORED_CLASSIC;
+
+// minimum size of the look-up tables to cover all moves with 16 bit encoding
+const size_t MIN_MV_LOOKUP_SIZE = 1 << 16;
 
 //https://stackoverflow.com/questions/23390034/c-change-global-variable-value-in-different-files
 extern std::string LABELS_MIRRORED[NB_LABELS];
 
 namespace Constants {
+/**
+ * @brief insert_move_idx Sets the index for the given move in the look-up table unless the move has been assigned before
+ * @param lookup Look-up table
+ * @param isSet Stores which moves have already been assigned
+ * @param move Move which is used as index
+ * @param idx Policy index
+ */
+inline void insert_move_idx(std::vector<uint16_t>& lookup, std::vector<bool>& isSet, Move move, size_t idx) {
+    if (!isSet[move]) {
+        lookup[move] = uint16_t(idx);
+        isSet[move] = true;
+    }
+}
+
 inline void init(bool isPolicyMap) {
 
-    // fill mirrored label list and look-up table
+    // fill mirrored label list and collect the Stockfish moves of every label
+    std::vector<std::vector<Move>> moves(NB_LABELS);
+    std::vector<std::vector<Move>> movesMirrored(NB_LABELS);
+    size_t lookupSize = MIN_MV_LOOKUP_SIZE;
     for (size_t mvIdx=0; mvIdx < NB_LABELS; mvIdx++) {
         LABELS_MIRRORED[mvIdx] = mirror_move(LABELS[mvIdx]);
-        std::vector<Move> moves = make_move(LABELS[mvIdx]);
-        for (Move move : moves) {
-            isPolicyMap ? MV_LOOKUP.insert({move, FLAT_PLANE_IDX[mvIdx]}) : MV_LOOKUP.insert({move, mvIdx});
-            MV_LOOKUP_CLASSIC.insert({move, mvIdx});
+        moves[mvIdx] = make_move(LABELS[mvIdx]);
+        movesMirrored[mvIdx] = make_move(LABELS_MIRRORED[mvIdx]);
+        for (Move move : moves[mvIdx]) {
+            lookupSize = std::max(lookupSize, size_t(move)+1);
+        }
+        for (Move move : movesMirrored[mvIdx]) {
+            lookupSize = std::max(lookupSize, size_t(move)+1);
+        }
+    }
+
+    // fill the flat look-up tables, the first label of a move takes precedence
+    for (std::vector<uint16_t>* lookup : {&MV_LOOKUP, &MV_LOOKUP_MIRRORED, &MV_LOOKUP_CLASSIC, &MV_LOOKUP_MIRRORED_CLASSIC}) {
+        lookup->assign(lookupSize, 0);
+    }
+    std::vector<bool> isSet(lookupSize, false);
+    std::vector<bool> isSetMirrored(lookupSize, false);
+    std::vector<bool> isSetClassic(lookupSize, false);
+    std::vector<bool> isSetMirroredClassic(lookupSize, false);
+    for (size_t mvIdx=0; mvIdx < NB_LABELS; mvIdx++) {
+        const size_t policyIdx = isPolicyMap ? FLAT_PLANE_IDX[mvIdx] : mvIdx;
+        for (Move move : moves[mvIdx]) {
+            insert_move_idx(MV_LOOKUP, isSet, move, policyIdx);
+            insert_move_idx(MV_LOOKUP_CLASSIC, isSetClassic, move, mvIdx);
         }
-        std::vector<Move> moves_mirrored = make_move(LABELS_MIRRORED[mvIdx]);
-        for (Move move : moves_mirrored) {
-            isPolicyMap ? MV_LOOKUP_MIRRORED.insert({move, FLAT_PLANE_IDX[mvIdx]}) : MV_LOOKUP_MIRRORED.insert({move, mvIdx});
-            MV_LOOKUP_MIRRORED_CLASSIC.insert({move, mvIdx});
+        for (Move move : movesMirrored[mvIdx]) {
+            insert_move_idx(MV_LOOKUP_MIRRORED, isSetMirrored, move, policyIdx);
+            insert_move_idx(MV_LOOKUP_MIRRORED_CLASSIC, isSetMirroredClassic, move, mvIdx);
         }
     }
 }
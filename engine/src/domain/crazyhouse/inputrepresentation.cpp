@@ -29,27 +29,131 @@
 #include <iostream>
 using namespace std;
 
+// index within a plane for every square from the view of the side to move
+// the board is mirrored vertically if black is to move
+const uint8_t PLANE_IDX[NB_PLAYERS][NB_SQUARES] = {
+    {
+     0, 1, 2, 3, 4, 5, 6, 7,
+     8, 9, 10, 11, 12, 13, 14, 15,
+     16, 17, 18, 19, 20, 21, 22, 23,
+     24, 25, 26, 27, 28, 29, 30, 31,
+     32, 33, 34, 35, 36, 37, 38, 39,
+     40, 41, 42, 43, 44, 45, 46, 47,
+     48, 49, 50, 51, 52, 53, 54, 55,
+     56, 57, 58, 59, 60, 61, 62, 63
+    },
+    {
+     56, 57, 58, 59, 60, 61, 62, 63,
+     48, 49, 50, 51, 52, 53, 54, 55,
+     40, 41, 42, 43, 44, 45, 46, 47,
+     32, 33, 34, 35, 36, 37, 38, 39,
+     24, 25, 26, 27, 28, 29, 30, 31,
+     16, 17, 18, 19, 20, 21, 22, 23,
+     8, 9, 10, 11, 12, 13, 14, 15,
+     0, 1, 2, 3, 4, 5, 6, 7
+    }
+};
+
 void set_bits_from_bitmap(Bitboard bitboard, size_t channel, float *inputPlanes, Color color) {
-    size_t p = 0;
+    float* plane = inputPlanes + channel * NB_SQUARES;
+    const uint8_t* planeIdx = PLANE_IDX[color];
     // set the individual bits for the pieces
     // https://lemire.me/blog/2018/02/21/iterating-over-set-bits-quickly/
     while (bitboard != 0) {
-        if (bitboard & 0x1) {
-            if (color == WHITE) {
-                inputPlanes[channel * NB_SQUARES + p] = 1;
-            }
-            else {
-                //                                         row            col
-                inputPlanes[channel * NB_SQUARES + (7 - (p / 8)) * 8 + (p % 8)] = 1;
-            }
-        }
-        bitboard >>= 1;
-        p++;
+        plane[planeIdx[pop_lsb(&bitboard)]] = 1;
     }
 }
 
 
-void board_to_planes(const Board *pos, int boardRepetition, bool normalize, float *inputPlanes) {
+/**
+ * @brief get_plane_idx Returns the index of a square within a plane from the view of the given side to move
+ * @param sq Square
+ * @param me Side to move
+ * @return Index in [0, NB_SQUARES)
+ */
+inline size_t get_plane_idx(Square sq, Color me)
+{
+    return PLANE_IDX[me][sq];
+}
+
+/**
+ * @brief get_ep_idx Returns the index of the en-passant square on the en-passant plane
+ * @param epSquare En-passant square
+ * @param me Side to move
+ * @return Index within the en-passant plane
+ */
+inline size_t get_ep_idx(Square epSquare, Color me)
+{
+    return me == WHITE ? int(epSquare) : 64-int(epSquare);
+}
+
+/**
+ * @brief set_constant_planes Sets all planes which hold a single value for the whole board,
+ * starting with the repetition planes up to the no progress counter. Planes are only written if their value changed.
+ * @param pos Board position
+ * @param boardRepetition Defines how often the board has already been repeated so far
+ * @param normalize Flag, telling if the representation should be rescaled into the [0,1] range
+ * @param inputPlanes Input planes which hold a valid encoding of any position with the same normalization
+ */
+void set_constant_planes(const Board *pos, int boardRepetition, bool normalize, float *inputPlanes)
+{
+    const Color me = pos->side_to_move();
+    const Color you = ~me;
+    size_t current_channel = NB_PLAYERS * NB_PIECE_TYPES;
+
+    // (II) Fill in the Repetition Data
+    // set how often the position has already occurred in the game (default 0 times)
+    // this is used to check for claiming the 3 fold repetition rule
+    // A game to test out if everything is working correctly is: https://lichess.org/jkItXBWy#73
+    update_constant_plane(inputPlanes, current_channel++, boardRepetition >= 1);
+    update_constant_plane(inputPlanes, current_channel++, boardRepetition >= 2);
+
+    // (III) Fill in the Prisoners / Pocket Pieces
+    // iterate over all pieces except the king
+    for (Color color : {me, you}) {
+        for (PieceType piece: {PAWN, KNIGHT, BISHOP, ROOK, QUEEN}) {
+            // unfortunately you can't use a loop over count_in_hand() PieceType because of template arguments
+            int pocket_cnt = pos->get_pocket_count(color, piece);
+            update_constant_plane(inputPlanes, current_channel++, normalize ? pocket_cnt / MAX_NB_PRISONERS : pocket_cnt);
+        }
+    }
+
+    // skip the promoted pieces and the en-passant square
+    current_channel += 3;
+
+    // (VI) Constant Value Inputs
+    // (VI.1) Color
+    update_constant_plane(inputPlanes, current_channel++, me == WHITE);
+
+    // (VI.2) Total Move Count
+    // stockfish starts counting from 0, the full move counter starts at 1 in FEN
+    update_constant_plane(inputPlanes, current_channel++,
+                          normalize ? ((pos->game_ply()/2)+1) / MAX_FULL_MOVE_COUNTER : ((pos->game_ply()/2)+1));
+
+    // (IV.3) Castling Rights
+    // the castling rights of the side to move come first
+    if (me == WHITE) {
+        for (CastlingRight castlingRight : {WHITE_OO, WHITE_OOO, BLACK_OO, BLACK_OOO}) {
+            update_constant_plane(inputPlanes, current_channel++, pos->can_castle(castlingRight));
+        }
+    }
+    else {
+        for (CastlingRight castlingRight : {BLACK_OO, BLACK_OOO, WHITE_OO, WHITE_OOO}) {
+            update_constant_plane(inputPlanes, current_channel++, pos->can_castle(castlingRight));
+        }
+    }
+
+    // (VI.4) No Progress Count
+    // define a no 'progress' counter
+    // it gets incremented by 1 each move
+    // however, whenever a piece gets dropped, a piece is captured or a pawn is moved, it is reset to 0
+    // halfmove_clock is an official metric in fen notation
+    //  -> see: https://en.wikipedia.org/wiki/Forsyth%E2%80%93Edwards_Notation
+    update_constant_plane(inputPlanes, current_channel++,
+                          normalize ? pos->rule50_count() / MAX_NB_NO_PROGRESS: pos->rule50_count());
+}
+
+void set_position_planes(const Board *pos, int boardRepetition, bool normalize, float *inputPlanes) {
 
     // intialize the input_planes with 0
     std::fill(inputPlanes, inputPlanes+NB_VALUES_TOTAL, 0.0f);
@@ -72,31 +176,8 @@ void board_to_planes(const Board *pos, int boardRepetition, bool normalize, floa
         }
     }
 
-    // (II) Fill in the Repetition Data
-    // set how often the position has already occurred in the game (default 0 times)
-    // this is used to check for claiming the 3 fold repetition rule
-    // A game to test out if everything is working correctly is: https://lichess.org/jkItXBWy#73
-    if (boardRepetition >= 1) {
-        std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES, 1.0f);
-        if (boardRepetition >= 2) {
-            std::fill(inputPlanes + (current_channel+1) * NB_SQUARES, inputPlanes + (current_channel+2) * NB_SQUARES, 1.0f);
-        }
-    }
-    current_channel+= 2;
-
-    // (III) Fill in the Prisoners / Pocket Pieces
-    // iterate over all pieces except the king
-    for (Color color : {me, you}) {
-        for (PieceType piece: {PAWN, KNIGHT, BISHOP, ROOK, QUEEN}) {
-            // unfortunately you can't use a loop over count_in_hand() PieceType because of template arguments
-            int pocket_cnt = pos->get_pocket_count(color, piece);
-            if (pocket_cnt > 0) {
-                std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES,
-                          normalize ? pocket_cnt / MAX_NB_PRISONERS : pocket_cnt);
-            }
-            current_channel++;
-        }
-    }
+    // (II) & (III) Repetition and pocket pieces are set in set_constant_planes()
+    current_channel += 2 + NB_PLAYERS * POCKETS_SIZE_PIECE_TYPE;
 
     // (IV) Fill in the promoted pieces
     // iterate over all promoted pieces according to the mask and set the according bit
@@ -108,104 +189,141 @@ void board_to_planes(const Board *pos, int boardRepetition, bool normalize, floa
     // (V) En Passant Square
     // mark the square where an en-passant capture is possible
     if (pos->ep_square() != SQ_NONE) {
-        unsigned int ep_square = me == WHITE ? int(pos->ep_square()) : 64-int(pos->ep_square());
-        inputPlanes[current_channel * NB_SQUARES + ep_square] = 1.0f;
+        inputPlanes[current_channel * NB_SQUARES + get_ep_idx(pos->ep_square(), me)] = 1.0f;
     }
-    current_channel++;
 
     // (VI) Constant Value Inputs
-    // (VI.1) Color
-    if (me == WHITE) {
-        std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES, 1.0f);
-    }
-    current_channel++;
+    set_constant_planes(pos, boardRepetition, normalize, inputPlanes);
+}
 
-    // (VI.2) Total Move Count
-    std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES,
-              // stockfish starts counting from 0, the full move counter starts at 1 in FEN
-              normalize ? ((pos->game_ply()/2)+1) / MAX_FULL_MOVE_COUNTER : ((pos->game_ply()/2)+1));
-    current_channel++;
+/**
+ * @brief mirror_plane_rows Mirrors the rows of a single plane in place
+ * @param plane Pointer to the start of the plane
+ */
+inline void mirror_plane_rows(float *plane)
+{
+    for (int row = 0; row < BOARD_HEIGHT / 2; ++row) {
+        std::swap_ranges(plane + row * BOARD_WIDTH, plane + (row+1) * BOARD_WIDTH, plane + (BOARD_HEIGHT-1-row) * BOARD_WIDTH);
+    }
+}
 
-    // (IV.3) Castling Rights
-    // check for King Side Castling
-    if (me == WHITE) {
-        if (pos->can_castle(WHITE_OO)) {
-            std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES, 1.0f);
-        }
-        current_channel++;
-        if (pos->can_castle(WHITE_OOO)) {
-            std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES, 1.0f);
-        }
-        current_channel++;
-        if (pos->can_castle(BLACK_OO)) {
-            std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES, 1.0f);
-        }
-        current_channel++;
-        if (pos->can_castle(BLACK_OOO)) {
-            std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES, 1.0f);
-        }
-        current_channel++;
-    }   else {
-        if (pos->can_castle(BLACK_OO)) {
-            std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES, 1.0f);
-        }
-        current_channel++;
-        if (pos->can_castle(BLACK_OOO)) {
-            std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES, 1.0f);
-        }
-        current_channel++;
-        if (pos->can_castle(WHITE_OO)) {
-            std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES, 1.0f);
-        }
-        current_channel++;
-        if (pos->can_castle(WHITE_OOO)) {
-            std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES, 1.0f);
-        }
-        current_channel++;
+/**
+ * @brief change_perspective Swaps the planes of both players and mirrors them vertically
+ * @param firstChannel First channel of the planes of the side to move
+ * @param nbChannels Number of channels per player
+ * @param inputPlanes Input planes
+ */
+inline void change_perspective(size_t firstChannel, size_t nbChannels, float *inputPlanes)
+{
+    float* mePlanes = inputPlanes + firstChannel * NB_SQUARES;
+    float* youPlanes = inputPlanes + (firstChannel + nbChannels) * NB_SQUARES;
+    std::swap_ranges(mePlanes, youPlanes, youPlanes);
+    for (size_t channel = firstChannel; channel < firstChannel + 2 * nbChannels; ++channel) {
+        mirror_plane_rows(inputPlanes + channel * NB_SQUARES);
+    }
+}
 
+/**
+ * @brief update_bits_from_bitmap Updates all squares of a plane on which the given bitboards differ
+ * @param refBitboard Bitboard which is currently encoded on the channel
+ * @param bitboard New bitboard
+ * @param channel Channel index
+ * @param inputPlanes Input planes
+ * @param me Side to move of the new position
+ */
+inline void update_bits_from_bitmap(Bitboard refBitboard, Bitboard bitboard, size_t channel, float *inputPlanes, Color me)
+{
+    Bitboard diff = refBitboard ^ bitboard;
+    while (diff) {
+        const Square sq = pop_lsb(&diff);
+        inputPlanes[channel * NB_SQUARES + get_plane_idx(sq, me)] = (bitboard & sq) ? 1.0f : 0.0f;
     }
+}
 
-    // (VI.4) No Progress Count
-    // define a no 'progress' counter
-    // it gets incremented by 1 each move
-    // however, whenever a piece gets dropped, a piece is captured or a pawn is moved, it is reset to 0
-    // halfmove_clock is an official metric in fen notation
-    //  -> see: https://en.wikipedia.org/wiki/Forsyth%E2%80%93Edwards_Notation
-    std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES,
-              normalize ? pos->rule50_count() / MAX_NB_NO_PROGRESS: pos->rule50_count());
-    current_channel++;
+void update_position_planes(const Board *refPos, const float *refPlanes, const Board *pos, int boardRepetition, bool normalize, float *inputPlanes)
+{
+    if (inputPlanes != refPlanes) {
+        std::copy(refPlanes, refPlanes+NB_VALUES_TOTAL, inputPlanes);
+    }
+    const Color refMe = refPos->side_to_move();
+    const Color me = pos->side_to_move();
+    const Color you = ~me;
 
-#ifndef CRAZYHOUSE_ONLY
-    // set the remaining checks (only needed for "3check")
-    if (pos->is_three_check()) {
-        for (Color color : {me, you}) {
-            if (pos->checks_given(color) != 0) {
-                std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES, 1.0f);
-                current_channel++;
-                if (pos->checks_given(color) >= 2) {
-                    std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES, 1.0f);
-                }
-                current_channel++;
-            }
-            else {
-                current_channel += 2;
-            }
+    // (I) Pieces, the planes of both players are swapped if the side to move changed
+    const size_t promotedChannel = NB_PLAYERS * NB_PIECE_TYPES + 2 + NB_PLAYERS * POCKETS_SIZE_PIECE_TYPE;
+    if (refMe != me) {
+        change_perspective(0, NB_PIECE_TYPES, inputPlanes);
+        change_perspective(promotedChannel, 1, inputPlanes);
+    }
+    size_t current_channel = 0;
+    for (Color color : {me, you}) {
+        for (PieceType piece: {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING}) {
+            update_bits_from_bitmap(refPos->pieces(color, piece), pos->pieces(color, piece), current_channel, inputPlanes, me);
+            current_channel++;
         }
     }
-    else {
-        current_channel += 4;
+
+    // (IV) Promoted pieces
+    update_bits_from_bitmap(refPos->promoted_pieces() & refPos->pieces(me), pos->promoted_pieces() & pos->pieces(me),
+                            promotedChannel, inputPlanes, me);
+    update_bits_from_bitmap(refPos->promoted_pieces() & refPos->pieces(you), pos->promoted_pieces() & pos->pieces(you),
+                            promotedChannel+1, inputPlanes, me);
+
+    // (V) En Passant Square
+    const size_t epChannel = promotedChannel + 2;
+    if (refPos->ep_square() != SQ_NONE) {
+        inputPlanes[epChannel * NB_SQUARES + get_ep_idx(refPos->ep_square(), refMe)] = 0.0f;
     }
+    if (pos->ep_square() != SQ_NONE) {
+        inputPlanes[epChannel * NB_SQUARES + get_ep_idx(pos->ep_square(), me)] = 1.0f;
+    }
+
+    // (II), (III), (VI) Constant planes
+    set_constant_planes(pos, boardRepetition, normalize, inputPlanes);
+}
+
+/**
+ * @brief The BoardToPlanes struct holds the arguments of board_to_planes() for the variant dispatch
+ */
+struct BoardToPlanes
+{
+    const Board *pos;
+    int boardRepetition;
+    bool normalize;
+    float *inputPlanes;
 
-    // (V) Variants specification
-    // set the is960 boolean flag when active
-    if (pos->is_chess960()) {
-        std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES, 1.0f);
+    template<Variant variant>
+    void run() {
+        board_to_planes<variant>(pos, boardRepetition, normalize, inputPlanes);
     }
+};
 
-    // set the current active variant as a one-hot encoded entry
-    current_channel += CHANNEL_MAPPING_VARIANTS.at(pos->variant());
-    std::fill(inputPlanes + current_channel * NB_SQUARES, inputPlanes + (current_channel+1) * NB_SQUARES, 1.0f);
-#endif
+/**
+ * @brief The BoardToPlanesIncremental struct holds the arguments of board_to_planes_incremental() for the variant dispatch
+ */
+struct BoardToPlanesIncremental
+{
+    const Board *refPos;
+    const float *refPlanes;
+    const Board *pos;
+    int boardRepetition;
+    bool normalize;
+    float *inputPlanes;
 
+    template<Variant variant>
+    void run() {
+        board_to_planes_incremental<variant>(refPos, refPlanes, pos, boardRepetition, normalize, inputPlanes);
+    }
+};
+
+void board_to_planes(const Board *pos, int boardRepetition, bool normalize, float *inputPlanes)
+{
+    BoardToPlanes functor = {pos, boardRepetition, normalize, inputPlanes};
+    dispatch_variant(pos->variant(), functor);
 }
 
+void board_to_planes_incremental(const Board *refPos, const float *refPlanes, const Board *pos, int boardRepetition, bool normalize, float *inputPlanes)
+{
+    BoardToPlanesIncremental functor = {refPos, refPlanes, pos, boardRepetition, normalize, inputPlanes};
+    dispatch_variant(pos->variant(), functor);
+}
@@ -29,6 +29,8 @@
 #define INPUTREPRESENTATION_H
 
 #include "../../board.h"
+#include "../variants.h"
+#include "constants.h"
 
 /**
  * @brief board_to_planes Converts the given board representation into the plane representation.
@@ -41,6 +43,109 @@
  */
 void board_to_planes(const Board *pos, int boardRepetition, bool normalize, float *inputPlanes);
 
+/**
+ * @brief board_to_planes Version of board_to_planes() for a variant which is known at compile time.
+ * It is used within the search which resolves the variant only once.
+ */
+template<Variant variant>
+void board_to_planes(const Board *pos, int boardRepetition, bool normalize, float *inputPlanes);
+
+/**
+ * @brief board_to_planes_incremental Derives the plane representation of a position from the encoding of a reference position,
+ *                        e.g. its parent or a sibling. Only the squares on which the bitboards differ are rewritten and
+ *                        constant planes are only filled if their value changed. The result is identical to board_to_planes().
+ * @param refPos Reference board position
+ * @param refPlanes Plane representation of refPos, which has been created with the same normalize flag
+ * @param pos Board position to encode
+ * @param boardRepetition Defines how often the board has already been repeated so far
+ * @param normalize Flag, telling if the representation should be rescaled into the [0,1] range using the scaling constants from "constants.h"
+ * @param inputPlanes Output where the plane representation will be stored. It may be the same memory as refPlanes.
+ */
+void board_to_planes_incremental(const Board *refPos, const float *refPlanes, const Board *pos, int boardRepetition, bool normalize, float *inputPlanes);
+
+/**
+ * @brief board_to_planes_incremental Version of board_to_planes_incremental() for a variant which is known at compile time.
+ */
+template<Variant variant>
+void board_to_planes_incremental(const Board *refPos, const float *refPlanes, const Board *pos, int boardRepetition, bool normalize, float *inputPlanes);
+
+/**
+ * @brief set_position_planes Sets all planes of board_to_planes() except the three-check and variant planes
+ */
+void set_position_planes(const Board *pos, int boardRepetition, bool normalize, float *inputPlanes);
+
+/**
+ * @brief update_position_planes Updates all planes of board_to_planes_incremental() except the three-check and variant planes
+ */
+void update_position_planes(const Board *refPos, const float *refPlanes, const Board *pos, int boardRepetition, bool normalize, float *inputPlanes);
+
+/**
+ * @brief update_constant_plane Assigns a constant value to a full plane. The plane is only written if its current value differs.
+ * @param inputPlanes Input planes which are assumed to be constant on the given channel
+ * @param channel Channel index
+ * @param value New value
+ */
+inline void update_constant_plane(float *inputPlanes, size_t channel, float value)
+{
+    float* plane = inputPlanes + channel * NB_SQUARES;
+    if (plane[0] != value) {
+        // the constant trip count allows the compiler to use vector stores
+        for (size_t idx = 0; idx < NB_SQUARES; ++idx) {
+            plane[idx] = value;
+        }
+    }
+}
+
+/**
+ * @brief set_variant_planes Sets the remaining checks for three-check, the is960 flag and the one-hot encoded variant.
+ * All variant checks are resolved at compile time.
+ * @param pos Board position
+ * @param inputPlanes Input planes which hold a valid encoding of any position
+ */
+template<Variant variant>
+inline void set_variant_planes(const Board *pos, float *inputPlanes)
+{
+#ifndef CRAZYHOUSE_ONLY
+    size_t current_channel = NB_CHANNELS_POS + NB_CHANNELS_CONST - 4;
+    // set the remaining checks (only needed for "3check")
+    for (Color color : {pos->side_to_move(), ~pos->side_to_move()}) {
+#ifdef THREECHECK
+        if (variant == THREECHECK_VARIANT) {
+            update_constant_plane(inputPlanes, current_channel++, pos->checks_given(color) >= 1);
+            update_constant_plane(inputPlanes, current_channel++, pos->checks_given(color) >= 2);
+            continue;
+        }
+#endif
+        update_constant_plane(inputPlanes, current_channel++, 0.0f);
+        update_constant_plane(inputPlanes, current_channel++, 0.0f);
+    }
+
+    // (V) Variants specification
+    // set the is960 boolean flag when active
+    update_constant_plane(inputPlanes, current_channel, pos->is_chess960());
+
+    // set the current active variant as a one-hot encoded entry
+    const int variantChannel = get_variant_channel(variant);
+    for (int channelOffset = 1; channelOffset < NB_CHANNELS_VARIANTS; ++channelOffset) {
+        update_constant_plane(inputPlanes, current_channel + channelOffset, channelOffset == variantChannel);
+    }
+#endif
+}
+
+template<Variant variant>
+void board_to_planes(const Board *pos, int boardRepetition, bool normalize, float *inputPlanes)
+{
+    set_position_planes(pos, boardRepetition, normalize, inputPlanes);
+    set_variant_planes<variant>(pos, inputPlanes);
+}
+
+template<Variant variant>
+void board_to_planes_incremental(const Board *refPos, const float *refPlanes, const Board *pos, int boardRepetition, bool normalize, float *inputPlanes)
+{
+    update_position_planes(refPos, refPlanes, pos, boardRepetition, normalize, inputPlanes);
+    set_variant_planes<variant>(pos, inputPlanes);
+}
+
 /**
  * @brief set_bits_from_bitmap Sets the individual bits from a given bitboard on the given channel for the inputPlanes
  * @param bitboard Bitboard of a single 8x8 plane
@@ -47,14 +47,14 @@ using namespace std;
  * @param isPolicyMap Sets if the policy is encoded in policy map representation
  * @return Starting pointer for predictions of the current batch
  */
-const float*  get_policy_data_batch(const size_t batchIdx, const NDArray* policyProb, bool isPolicyMap);
+const float*  get_policy_data_batch(const size_t batchIdx, const float* policyProb, bool isPolicyMap);
 
 /**
  * @brief get_current_move_lookup Returns the look-up table to use depending on the side to move
  * @param sideToMove Current side to move
  * @return Returns either MOVE_LOOK_UP or MOVE_LOOK_UP_MIRRORED
  */
-unordered_map<Move, size_t>& get_current_move_lookup(Color sideToMove);
+const vector<uint16_t>& get_current_move_lookup(Color sideToMove);
 
 /**
  * @brief get_probs_of_move_list Returns an array in which entry relates to the probability for the given move list.
@@ -68,11 +68,18 @@ unordered_map<Move, size_t>& get_current_move_lookup(Color sideToMove);
  * @param select_policy_from_plance Sets if the policy is encoded in policy map representation
  * @return policyProbSmall - A hybrid blaze vector which stores the probabilities for the given move list
  */
-void get_probs_of_move_list(const size_t batchIdx, const NDArray* policyProb, const std::vector<Move> &legalMoves, Color sideToMove,
+void get_probs_of_move_list(const size_t batchIdx, const float* policyProb, const std::vector<Move> &legalMoves, Color sideToMove,
                             bool normalize, DynamicVector<float> &policyProbSmall, bool select_policy_from_plance);
 
+/**
+ * @brief get_probs_of_moves Gathers the probabilities of the given legal moves from the raw policy output
+ * @param data Policy output of a single batch element
+ * @param legalMoves List of legal moves
+ * @param moveLookup Flat look-up table which is directly indexed by the move
+ * @param policyProbSmall Output vector which must have the same size as legalMoves
+ */
 void get_probs_of_moves(const float *data, const vector<Move>& legalMoves,
-                        unordered_map<Move, size_t>& moveLookup, DynamicVector<float> &policyProbSmall);
+                        const vector<uint16_t>& moveLookup, DynamicVector<float> &policyProbSmall);
 
 /**
  * @brief value_to_centipawn Converts a value in A0-notation to roughly a centi-pawn loss
@@ -100,4 +100,54 @@ const static string StartFENs[SUBVARIANT_NB] = {
     #endif
 };
 
+/**
+ * @brief dispatch_variant Calls the specialization of a variant templated function for the given runtime variant.
+ * This way the variant is only resolved once, e.g. when the search starts, and all variant checks within the hot loops
+ * are evaluated at compile time. The functor must provide a member function template "template<Variant variant> run()".
+ * Variants without a dedicated specialization fall back to the generic chess code.
+ * @param variant Active variant
+ * @param functor Object which holds the arguments of the call
+ * @return Return value of the called specialization
+ */
+template<typename Functor>
+auto dispatch_variant(Variant variant, Functor& functor) -> decltype(functor.template run<CHESS_VARIANT>())
+{
+#ifdef CRAZYHOUSE_ONLY
+    return functor.template run<CRAZYHOUSE_VARIANT>();
+#else
+    switch (variant) {
+    #ifdef CRAZYHOUSE
+    case CRAZYHOUSE_VARIANT:
+        return functor.template run<CRAZYHOUSE_VARIANT>();
+    #endif
+    #ifdef KOTH
+    case KOTH_VARIANT:
+        return functor.template run<KOTH_VARIANT>();
+    #endif
+    #ifdef THREECHECK
+    case THREECHECK_VARIANT:
+        return functor.template run<THREECHECK_VARIANT>();
+    #endif
+    #ifdef ANTI
+    case ANTI_VARIANT:
+        return functor.template run<ANTI_VARIANT>();
+    #endif
+    #ifdef ATOMIC
+    case ATOMIC_VARIANT:
+        return functor.template run<ATOMIC_VARIANT>();
+    #endif
+    #ifdef HORDE
+    case HORDE_VARIANT:
+        return functor.template run<HORDE_VARIANT>();
+    #endif
+    #ifdef RACE
+    case RACE_VARIANT:
+        return functor.template run<RACE_VARIANT>();
+    #endif
+    default:
+        return functor.template run<CHESS_VARIANT>();
+    }
+#endif
+}
+
 #endif // VARIANTS_H
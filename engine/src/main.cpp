@@ -28,11 +28,11 @@
 #include "tests/tests.h"
 #include "crazyara.h"
 
-#ifndef BUILD_TESTS
+#if !defined(BUILD_TESTS) && !defined(BUILD_BENCHMARKS)
 int main(int argc, char* argv[]) {
     CrazyAra crazyara;
     crazyara.init();
     crazyara.welcome();
-    crazyara.uci_loop(argc, argv);
+    return crazyara.uci_loop(argc, argv);
 }
 #endif
@@ -0,0 +1,139 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: subtreereclaimer.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "subtreereclaimer.h"
+#include <vector>
+
+SubtreeReclaimer::SubtreeReclaimer(unordered_map<Key, Node*>* hashTable, mutex* hashTableMtx):
+    hashTable(hashTable),
+    hashTableMtx(hashTableMtx),
+    isReclaiming(false),
+    isRunning(true)
+{
+    worker = thread(&SubtreeReclaimer::run, this);
+}
+
+SubtreeReclaimer::~SubtreeReclaimer()
+{
+    {
+        lock_guard<mutex> lock(mtx);
+        isRunning = false;
+    }
+    cvPending.notify_one();
+    worker.join();
+}
+
+void SubtreeReclaimer::reclaim_subtree(Node* subtreeRoot)
+{
+    {
+        lock_guard<mutex> lock(mtx);
+        pendingSubtrees.push_back(subtreeRoot);
+    }
+    cvPending.notify_one();
+}
+
+void SubtreeReclaimer::reclaim_sibling_subtrees(Node* node)
+{
+    if (node->get_parent_node() == nullptr) {
+        return;
+    }
+    {
+        lock_guard<mutex> lock(mtx);
+        for (Node* childNode: node->get_parent_node()->get_child_nodes()) {
+            if (childNode != node) {
+                pendingSubtrees.push_back(childNode);
+            }
+        }
+    }
+    cvPending.notify_one();
+}
+
+void SubtreeReclaimer::wait_until_idle()
+{
+    unique_lock<mutex> lock(mtx);
+    cvIdle.wait(lock, [this]{ return pendingSubtrees.empty() && !isReclaiming; });
+}
+
+void SubtreeReclaimer::run()
+{
+    unique_lock<mutex> lock(mtx);
+    while (true) {
+        cvPending.wait(lock, [this]{ return !pendingSubtrees.empty() || !isRunning; });
+        // the remaining subtrees are still freed when the reclaimer is stopped
+        if (pendingSubtrees.empty()) {
+            return;
+        }
+        Node* subtreeRoot = pendingSubtrees.front();
+        pendingSubtrees.pop_front();
+        isReclaiming = true;
+        lock.unlock();
+        free_subtree(subtreeRoot);
+        lock.lock();
+        isReclaiming = false;
+        if (pendingSubtrees.empty()) {
+            cvIdle.notify_all();
+        }
+    }
+}
+
+void SubtreeReclaimer::free_subtree(Node* subtreeRoot)
+{
+    vector<Node*> openNodes = {subtreeRoot};
+    vector<Node*> batch;
+    batch.reserve(RECLAIM_BATCH_SIZE);
+
+    while (!openNodes.empty()) {
+        // collect a batch of nodes, the child nodes must be read before their parent is freed
+        while (!openNodes.empty() && batch.size() < RECLAIM_BATCH_SIZE) {
+            Node* node = openNodes.back();
+            openNodes.pop_back();
+            for (Node* childNode: node->get_child_nodes()) {
+                openNodes.push_back(childNode);
+            }
+            batch.push_back(node);
+        }
+
+        // remove the hash entries first, so that no search thread can find the nodes anymore
+        hashTableMtx->lock();
+        for (Node* node : batch) {
+            if (node->is_expanded()) {
+                // the board position is only filled if the node has been extended
+                auto it = hashTable->find(node->hash_key());
+                if (it != hashTable->end() && it->second == node) {
+                    hashTable->erase(it);
+                }
+            }
+        }
+        hashTableMtx->unlock();
+
+        for (Node* node : batch) {
+            delete node;
+        }
+        batch.clear();
+        // give way to the search threads
+        this_thread::yield();
+    }
+}
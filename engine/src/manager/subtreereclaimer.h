@@ -0,0 +1,102 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: subtreereclaimer.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * The subtree reclaimer frees discarded subtrees of the search tree in a background thread,
+ * so that the search on a new root node can start immediately.
+ */
+
+#ifndef SUBTREERECLAIMER_H
+#define SUBTREERECLAIMER_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include "../node.h"
+
+// number of nodes which are freed between two releases of the hash table lock
+const size_t RECLAIM_BATCH_SIZE = 1024;
+
+class SubtreeReclaimer
+{
+private:
+    unordered_map<Key, Node*>* hashTable;
+    // lock which protects the hash table against concurrent access of the search threads
+    mutex* hashTableMtx;
+
+    // root nodes of all subtrees which wait to be freed
+    deque<Node*> pendingSubtrees;
+    mutex mtx;
+    condition_variable cvPending;
+    condition_variable cvIdle;
+    bool isReclaiming;
+    bool isRunning;
+    thread worker;
+
+    /**
+     * @brief run Main loop of the worker thread which frees the pending subtrees
+     */
+    void run();
+
+    /**
+     * @brief free_subtree Frees all nodes of the given subtree and removes their hash table entries.
+     * The hash table lock is only held for a batch of nodes at a time and the thread yields between the batches.
+     * @param subtreeRoot Root node of the subtree
+     */
+    void free_subtree(Node* subtreeRoot);
+
+public:
+    /**
+     * @brief SubtreeReclaimer
+     * @param hashTable Hash table which may contain entries of the discarded nodes
+     * @param hashTableMtx Lock which must be held for every access of the hash table
+     */
+    SubtreeReclaimer(unordered_map<Key, Node*>* hashTable, mutex* hashTableMtx);
+
+    /**
+     * @brief ~SubtreeReclaimer Frees all remaining subtrees and stops the worker thread
+     */
+    ~SubtreeReclaimer();
+
+    /**
+     * @brief reclaim_subtree Hands the given subtree over to the worker thread. The nodes must not be accessed afterwards.
+     * @param subtreeRoot Root node of the subtree
+     */
+    void reclaim_subtree(Node* subtreeRoot);
+
+    /**
+     * @brief reclaim_sibling_subtrees Hands all subtrees of the sibling nodes of the given node over to the worker thread
+     * @param node Node which is kept
+     */
+    void reclaim_sibling_subtrees(Node* node);
+
+    /**
+     * @brief wait_until_idle Blocks until all pending subtrees have been freed
+     */
+    void wait_until_idle();
+};
+
+#endif // SUBTREERECLAIMER_H
@@ -25,6 +25,9 @@
 
 #include "timemanager.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
 
 using namespace std;
 
@@ -32,6 +35,7 @@ using namespace std;
 TimeManager::TimeManager(float randomMoveFactor, int expectedGameLength, int threshMove, float moveFactor, float incrementFactor, int timeBufferFactor):
     curMovetime(0),  // will be updated later
     timeBuffer(0),   // will be updated later
+    timeBank{0, 0},
     randomMoveFactor(randomMoveFactor),
     expectedGameLength(expectedGameLength),
     threshMove(threshMove),
@@ -48,38 +52,74 @@ int TimeManager::get_time_for_move(SearchLimits* searchLimits, Color me, int mov
 {
     // leave an additional time buffer to avoid losing on time
     timeBuffer = searchLimits->moveOverhead * timeBufferFactor;
+    const int moveOverhead = get_move_overhead(searchLimits, me);
+
+    if (searchLimits->movetime != 0 || searchLimits->time[me] == 0) {
+        timeBank[me] = 0;
+    }
+    else {
+        // never bank more than a quarter of the safe remaining time
+        timeBank[me] = max(0, min(timeBank[me], (searchLimits->time[me] - timeBuffer) / 4));
+    }
+    // the banked time is reserved for critical positions and isn't spread over the regular moves
+    const int remainingTime = searchLimits->time[me] - timeBuffer - timeBank[me];
 
     if (searchLimits->movetime != 0) {
         // only return the plain move time substracted by the move overhead
-        curMovetime = searchLimits->movetime - searchLimits->moveOverhead;
+        curMovetime = searchLimits->movetime - moveOverhead;
     }
     else if (searchLimits->movestogo != 0) {
         // calculate a constant move time based on increment and moves left
-        curMovetime = int(((searchLimits->time[me] - timeBuffer) / float(searchLimits->movestogo) + 0.5f)
-                + searchLimits->inc[me] - searchLimits->moveOverhead);
+        curMovetime = int((remainingTime / float(searchLimits->movestogo) + 0.5f)
+                + searchLimits->inc[me] - moveOverhead);
     }
     else if (searchLimits->time[me] != 0) {
         // calculate a movetime in sudden death mode
         if (moveNumber < threshMove) {
-            curMovetime = int((searchLimits->time[me] - timeBuffer) / float(expectedGameLength-moveNumber) + 0.5f)
-                    + int(searchLimits->inc[me] * incrementFactor) - searchLimits->moveOverhead;
+            curMovetime = int(remainingTime / float(expectedGameLength-moveNumber) + 0.5f)
+                    + int(searchLimits->inc[me] * incrementFactor) - moveOverhead;
         }
         else {
-            curMovetime = int((searchLimits->time[me] - timeBuffer) * moveFactor + 0.5f)
-                    + int(searchLimits->inc[me] * incrementFactor) - searchLimits->moveOverhead;
+            curMovetime = int(remainingTime * moveFactor + 0.5f)
+                    + int(searchLimits->inc[me] * incrementFactor) - moveOverhead;
         }
     }
     else {
-        curMovetime = 1000 - searchLimits->moveOverhead;
+        curMovetime = 1000 - moveOverhead;
         cout << "info string No limit specification given, setting movetime to " << curMovetime << "ms" << endl;
     }
 
     if (curMovetime <= 0) {
-        curMovetime = searchLimits->moveOverhead * 2;
+        curMovetime = max(moveOverhead * 2, 1);
     }
     return apply_random_factor(curMovetime);
 }
 
+void TimeManager::save_time(SearchLimits* searchLimits, Color me, int savedTime)
+{
+    if (searchLimits->movetime == 0 && savedTime > 0) {
+        timeBank[me] += savedTime;
+    }
+}
+
+int TimeManager::take_from_time_bank(Color me, int maxTime)
+{
+    const int grantedTime = max(0, min(timeBank[me], maxTime));
+    timeBank[me] -= grantedTime;
+    return grantedTime;
+}
+
+void TimeManager::reset_time_bank()
+{
+    timeBank[WHITE] = 0;
+    timeBank[BLACK] = 0;
+}
+
+int TimeManager::get_time_bank(Color me) const
+{
+    return timeBank[me];
+}
+
 int TimeManager::apply_random_factor(int curMovetime)
 {
     if (randomMoveFactor > 0) {
@@ -92,3 +132,57 @@ float TimeManager::get_current_random_factor()
 {
     return (float(rand()) / RAND_MAX) * randomMoveFactor * 2 - randomMoveFactor;
 }
+
+string TimeManager::get_time_control_key(const SearchLimits* searchLimits, Color me) const
+{
+    stringstream ss;
+    if (searchLimits->movetime != 0) {
+        ss << "movetime " << searchLimits->movetime;
+    }
+    else if (searchLimits->time[me] != 0) {
+        ss << "inc " << searchLimits->inc[me];
+        if (searchLimits->movestogo != 0) {
+            ss << " movestogo";
+        }
+    }
+    else {
+        ss << "none";
+    }
+    return ss.str();
+}
+
+int TimeManager::get_move_overhead(const SearchLimits* searchLimits, Color me) const
+{
+    if (!searchLimits->adaptiveMoveOverhead) {
+        return searchLimits->moveOverhead;
+    }
+    auto it = lagStatistics.find(get_time_control_key(searchLimits, me));
+    if (it == lagStatistics.end() || it->second.samples < MIN_LAG_SAMPLES) {
+        return searchLimits->moveOverhead;
+    }
+    const LagStatistics& stats = it->second;
+    const int moveOverhead = int(ceil(stats.meanLag + LAG_DEVIATION_FACTOR * stats.meanDeviation));
+    return min(max(moveOverhead, 0), MAX_ADAPTIVE_MOVE_OVERHEAD);
+}
+
+void TimeManager::update_move_overhead(const SearchLimits* searchLimits, Color me, int lag)
+{
+    const string key = get_time_control_key(searchLimits, me);
+    LagStatistics& stats = lagStatistics[key];  // value initialized on first access
+    if (stats.samples == 0) {
+        stats.meanLag = lag;
+        stats.meanDeviation = 0;
+        stats.maxLag = lag;
+    }
+    else {
+        // use the plain average for the first samples and a running average afterwards
+        const float alpha = max(1.0f / (stats.samples + 1), LAG_SMOOTHING);
+        stats.meanDeviation += alpha * (abs(lag - stats.meanLag) - stats.meanDeviation);
+        stats.meanLag += alpha * (lag - stats.meanLag);
+        stats.maxLag = max(stats.maxLag, lag);
+    }
+    ++stats.samples;
+    cout << "info string lag " << lag << "ms time control " << key << " samples " << stats.samples
+         << " mean " << int(stats.meanLag + 0.5f) << "ms deviation " << int(stats.meanDeviation + 0.5f) << "ms max " << stats.maxLag
+         << "ms move overhead " << get_move_overhead(searchLimits, me) << "ms" << endl;
+}
@@ -29,13 +29,40 @@
 #ifndef TIMEMANAGER_H
 #define TIMEMANAGER_H
 
+#include <string>
+#include <unordered_map>
 #include "../agents/config/searchlimits.h"
 
+// minimum number of lag measurements before the adaptive move overhead replaces the static one
+const int MIN_LAG_SAMPLES = 3;
+// smoothing factor of the running lag statistics
+const float LAG_SMOOTHING = 0.2f;
+// number of mean deviations which are added to the mean lag as a safety margin
+const float LAG_DEVIATION_FACTOR = 3.0f;
+// maximum value for the adaptive move overhead in ms
+const int MAX_ADAPTIVE_MOVE_OVERHEAD = 5000;
+
+/**
+ * @brief The LagStatistics struct holds running statistics about the lag between the planned end of the search
+ * and the moment the bestmove was sent
+ */
+struct LagStatistics
+{
+    int samples;
+    float meanLag;
+    float meanDeviation;
+    int maxLag;
+};
+
 class TimeManager
 {
 private:
     int curMovetime;
     int timeBuffer;
+    // time in ms for each color which has been saved on previous moves and is reserved for critical positions
+    int timeBank[COLOR_NB];
+    // measured lag statistics for every time control
+    std::unordered_map<std::string, LagStatistics> lagStatistics;
 
     float randomMoveFactor;
     int expectedGameLength;
@@ -57,6 +84,14 @@ private:
      * @return randomly generated factor
      */
     float inline get_current_random_factor();
+
+    /**
+     * @brief get_time_control_key Returns an identifier of the time control of the given search limits
+     * @param searchLimits Limit specification for the current position
+     * @param me Color of the current player
+     * @return Key for the lag statistics
+     */
+    std::string get_time_control_key(const SearchLimits* searchLimits, Color me) const;
 public:
 
     /**
@@ -66,7 +101,7 @@ public:
      * @param expectedGameLength Expected game length for the game in full moves
      * @param threshMove Threshold move on which the constant move regime will switch to a proportional one
      * @param moveFactor Portion of the current move time which will be used in the proportional movetime regime
-     * @param timeBufferFactor Factor which is applied on the moveOverhead to calculate a time buffer for avoiding losing on time
+     * @param timeBufferFactor Factor which is applied on the static moveOverhead to calculate a time buffer for avoiding losing on time
      */
     TimeManager(float randomMoveFactor=0, int expectedGameLength=50, int threshMove=40, float moveFactor=0.05f, float incrementFactor=0.7f, int timeBufferFactor=30.0f);
 
@@ -74,12 +109,56 @@ public:
      * @brief get_time_for_move Calculates the movetime based on the searchSettigs
      * It uses a constant movetime for the first moves until the ``threshMove`` is reached.
      * Afterwards it uses a portion of the remaining time as defined in ``moveFact`
+     * The time in the time bank is excluded from the remaining time, because it is only spent via take_from_time_bank().
      * @param searchLimits Limit specification for the current position
      * @param me Color of the current player
      * @param moveNumber Move number of the position (ply//2)
      * @return movetime in ms
      */
     int get_time_for_move(SearchLimits* searchLimits, Color me, int moveNumber);
+
+    /**
+     * @brief save_time Adds the time which wasn't used for the current move to the time bank.
+     * The time bank is only filled when the engine plays on a clock, since a fixed movetime can't be carried over.
+     * @param searchLimits Limit specification for the current position
+     * @param me Color of the current player
+     * @param savedTime Unused time of the current move in ms
+     */
+    void save_time(SearchLimits* searchLimits, Color me, int savedTime);
+
+    /**
+     * @brief take_from_time_bank Withdraws time from the time bank
+     * @param me Color of the current player
+     * @param maxTime Maximum amount of time in ms which is requested
+     * @return Granted time in ms which is at most maxTime
+     */
+    int take_from_time_bank(Color me, int maxTime);
+
+    /**
+     * @brief reset_time_bank Clears the time banks of both colors, e.g. when a new game starts
+     */
+    void reset_time_bank();
+
+    int get_time_bank(Color me) const;
+
+    /**
+     * @brief get_move_overhead Returns the move overhead which is applied on the movetime. If the adaptive move overhead is enabled
+     * and enough lag measurements are available, it is the mean lag of the time control plus a safety margin.
+     * Otherwise the static moveOverhead of the search limits is returned.
+     * @param searchLimits Limit specification for the current position
+     * @param me Color of the current player
+     * @return Move overhead in ms
+     */
+    int get_move_overhead(const SearchLimits* searchLimits, Color me) const;
+
+    /**
+     * @brief update_move_overhead Adds a new lag measurement to the statistics of the current time control
+     * and prints the calibration statistics as an info string.
+     * @param searchLimits Limit specification of the finished search
+     * @param me Color of the current player
+     * @param lag Measured time in ms which was spent in addition to the planned search time until the bestmove was sent
+     */
+    void update_move_overhead(const SearchLimits* searchLimits, Color me, int lag);
 };
 
 
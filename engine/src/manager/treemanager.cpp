@@ -24,6 +24,7 @@
  */
 
 #include "treemanager.h"
+#include <algorithm>
 #include "misc.h"
 #include "../node.h"
 
@@ -43,3 +44,62 @@ bool same_hash_key(Node* node, Board *pos)
 {
     return node != nullptr && node->hash_key() == pos->hash_key();
 }
+
+vector<Node*> get_node_path(Node* rootNode, const Board* pos)
+{
+    // collect the keys of all positions after the root position, starting with the requested position
+    vector<Key> keys;
+    bool foundRoot = false;
+    for (const StateInfo* st = pos->getStateInfo(); st != nullptr; st = st->previous) {
+        if (st->key == rootNode->hash_key()) {
+            foundRoot = true;
+            break;
+        }
+        keys.push_back(st->key);
+    }
+    if (!foundRoot || keys.empty()) {
+        return {};
+    }
+
+    vector<Node*> path;
+    Node* node = rootNode;
+    for (auto it = keys.rbegin(); it != keys.rend(); ++it) {
+        Node* nextNode = nullptr;
+        for (Node* childNode : node->get_child_nodes()) {
+            // only expanded nodes hold a board position
+            if (childNode->is_expanded() && childNode->hash_key() == *it) {
+                nextNode = childNode;
+                break;
+            }
+        }
+        if (nextNode == nullptr) {
+            return {};
+        }
+        path.push_back(nextNode);
+        node = nextNode;
+    }
+    return path;
+}
+
+/**
+ * @brief is_in_sibling_subtree Checks if the candidate node lies in the subtree of a sibling of the given node
+ */
+bool is_in_sibling_subtree(const Node* candidate, const Node* node)
+{
+    const Node* parentNode = node->get_parent_node();
+    for (const Node* curNode = candidate; curNode != nullptr; curNode = curNode->get_parent_node()) {
+        if (curNode->get_parent_node() == parentNode) {
+            return curNode != node;
+        }
+    }
+    return false;
+}
+
+void remove_sibling_subtree_nodes(vector<Node*>& nodes, const Node* node)
+{
+    if (node->get_parent_node() == nullptr) {
+        return;
+    }
+    nodes.erase(remove_if(nodes.begin(), nodes.end(), [node](const Node* candidate) { return is_in_sibling_subtree(candidate, node); }),
+                nodes.end());
+}
@@ -47,4 +47,23 @@ Node* pick_next_node(Move move, const Node* parentNode);
  */
 bool same_hash_key(Node* node, Board *pos);
 
+/**
+ * @brief get_node_path Looks up the node of the given position anywhere below the root node.
+ * The hash keys of the previous positions of pos are followed back until the position of the root node is reached.
+ * Afterwards the tree is descended from the root node along these keys, which verifies the move path.
+ * @param rootNode Root node of the current search tree
+ * @param pos Requested board position including its history
+ * @return Nodes of the path from the first child of the root node down to the node of the position.
+ * The vector is empty if the position isn't reachable in the expanded part of the tree.
+ */
+vector<Node*> get_node_path(Node* rootNode, const Board* pos);
+
+/**
+ * @brief remove_sibling_subtree_nodes Removes all nodes from the list which lie in the subtree of a sibling of the given node.
+ * It must be called before the sibling subtrees are reclaimed, so that the nodes aren't freed a second time.
+ * @param nodes List of nodes, e.g. the game nodes of an agent
+ * @param node Node whose sibling subtrees will be freed
+ */
+void remove_sibling_subtree_nodes(vector<Node*>& nodes, const Node* node);
+
 #endif // TREEMANAGER_H
@@ -0,0 +1,279 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: treesnapshot.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "treesnapshot.h"
+#include <fstream>
+#include <queue>
+#include <cstring>
+#include <cstdio>
+#include "../node.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief get_fen_size Returns the number of bytes which are reserved for the FEN in the file
+ */
+inline size_t get_fen_size(size_t fenLength)
+{
+    return (fenLength + 7) / 8 * 8;
+}
+
+TreeSnapshot::TreeSnapshot():
+    data(nullptr),
+    dataSize(0),
+    header(nullptr),
+    records(nullptr)
+{
+}
+
+TreeSnapshot::~TreeSnapshot()
+{
+    close();
+}
+
+bool TreeSnapshot::open(const string& filename)
+{
+    close();
+#ifdef _WIN32
+    ifstream file(filename, ios::binary | ios::ate);
+    if (!file) {
+        return false;
+    }
+    buffer.resize(size_t(file.tellg()));
+    file.seekg(0);
+    file.read(buffer.data(), buffer.size());
+    data = buffer.data();
+    dataSize = buffer.size();
+#else
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == -1 || fileStat.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    dataSize = size_t(fileStat.st_size);
+    void* mapping = mmap(nullptr, dataSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after closing the file descriptor
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        dataSize = 0;
+        return false;
+    }
+    data = static_cast<const char*>(mapping);
+#endif
+    header = reinterpret_cast<const TreeFileHeader*>(data);
+    if (!is_valid()) {
+        close();
+        return false;
+    }
+    fen = string(data + sizeof(TreeFileHeader), header->fenLength);
+    records = reinterpret_cast<const TreeNodeRecord*>(data + sizeof(TreeFileHeader) + get_fen_size(header->fenLength));
+    // corrupted child indices could create cycles in the tree
+    for (uint64_t idx = 0; idx < header->numberRecords; ++idx) {
+        if (!has_valid_children(uint32_t(idx))) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TreeSnapshot::is_valid() const
+{
+    if (dataSize < sizeof(TreeFileHeader) || memcmp(header->magic, TREE_FILE_MAGIC, sizeof(TREE_FILE_MAGIC)) != 0 ||
+            header->version != TREE_FILE_VERSION || header->numberRecords == 0) {
+        return false;
+    }
+    return dataSize >= sizeof(TreeFileHeader) + get_fen_size(header->fenLength) + header->numberRecords * sizeof(TreeNodeRecord);
+}
+
+void TreeSnapshot::close()
+{
+#ifdef _WIN32
+    buffer.clear();
+#else
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), dataSize);
+    }
+#endif
+    data = nullptr;
+    dataSize = 0;
+    header = nullptr;
+    records = nullptr;
+}
+
+const TreeNodeRecord& TreeSnapshot::get_record(uint32_t idx) const
+{
+    return records[idx];
+}
+
+bool TreeSnapshot::has_valid_children(uint32_t idx) const
+{
+    const TreeNodeRecord& record = records[idx];
+    if (record.numberChildNodes == 0) {
+        return true;
+    }
+    return record.firstChildIdx > idx && uint64_t(record.firstChildIdx) + record.numberChildNodes <= header->numberRecords;
+}
+
+uint64_t TreeSnapshot::get_number_records() const
+{
+    return header->numberRecords;
+}
+
+const string& TreeSnapshot::get_fen() const
+{
+    return fen;
+}
+
+Key TreeSnapshot::get_root_key() const
+{
+    return Key(header->rootKey);
+}
+
+Variant TreeSnapshot::get_variant() const
+{
+    return Variant(header->variant);
+}
+
+bool TreeSnapshot::is_chess960() const
+{
+    return header->isChess960 != 0;
+}
+
+/**
+ * @brief create_record Creates the record for a node of the search tree without the child information.
+ * The value and flags of nodes which still refer to a snapshot record are taken from the snapshot.
+ */
+TreeNodeRecord create_record(const Node* node)
+{
+    TreeNodeRecord record;
+    record.move = uint32_t(node->get_move());
+    record.probValue = node->get_prob_value();
+    record.visits = node->get_visits();
+    record.actionValue = node->get_action_value();
+    record.qValue = node->get_q_value();
+    record.value = node->get_value();
+    record.firstChildIdx = 0;
+    record.numberChildNodes = 0;
+    record.flags = (node->is_expanded() ? RECORD_EXPANDED : 0) | (node->is_terminal() ? RECORD_TERMINAL : 0) |
+            (node->has_nn_results() ? RECORD_NN_RESULTS : 0);
+    if (node->has_snapshot_record()) {
+        // the node hasn't been expanded since loading, its state is still described by the snapshot
+        const TreeNodeRecord& snapshotRecord = node->get_snapshot()->get_record(node->get_snapshot_idx());
+        record.value = snapshotRecord.value;
+        record.flags = snapshotRecord.flags;
+    }
+    record.padding = 0;
+    return record;
+}
+
+/**
+ * @brief The RecordSource struct describes where the child nodes of a record are taken from.
+ * This is either a node of the search tree or a record of a previously loaded snapshot.
+ */
+struct RecordSource
+{
+    const Node* node;
+    const TreeSnapshot* snapshot;
+    uint32_t snapshotIdx;
+    uint32_t recordIdx;
+};
+
+size_t save_tree(const Node* rootNode, const string& filename)
+{
+    vector<TreeNodeRecord> records;
+    records.push_back(create_record(rootNode));
+    queue<RecordSource> openSources;
+    openSources.push({rootNode, rootNode->get_snapshot(), rootNode->get_snapshot_idx(), 0});
+
+    while (!openSources.empty()) {
+        const RecordSource source = openSources.front();
+        openSources.pop();
+        const uint32_t firstChildIdx = uint32_t(records.size());
+        if (source.node != nullptr && source.snapshot == nullptr) {
+            for (const Node* childNode : source.node->get_child_nodes()) {
+                openSources.push({childNode, childNode->get_snapshot(), childNode->get_snapshot_idx(), uint32_t(records.size())});
+                records.push_back(create_record(childNode));
+            }
+        }
+        else if (source.snapshot != nullptr) {
+            // the subtree hasn't been materialized yet and is copied from the loaded snapshot
+            const TreeNodeRecord& snapshotRecord = source.snapshot->get_record(source.snapshotIdx);
+            if (source.snapshot->has_valid_children(source.snapshotIdx)) {
+                for (uint32_t idx = 0; idx < snapshotRecord.numberChildNodes; ++idx) {
+                    const uint32_t childIdx = snapshotRecord.firstChildIdx + idx;
+                    openSources.push({nullptr, source.snapshot, childIdx, uint32_t(records.size())});
+                    records.push_back(source.snapshot->get_record(childIdx));
+                }
+            }
+        }
+        records[source.recordIdx].firstChildIdx = firstChildIdx;
+        records[source.recordIdx].numberChildNodes = uint16_t(records.size() - firstChildIdx);
+    }
+
+    const string fen = rootNode->get_pos()->fen();
+    TreeFileHeader header;
+    memcpy(header.magic, TREE_FILE_MAGIC, sizeof(TREE_FILE_MAGIC));
+    header.version = TREE_FILE_VERSION;
+    header.fenLength = uint32_t(fen.size());
+    header.rootKey = uint64_t(rootNode->hash_key());
+    header.numberRecords = records.size();
+    header.variant = int32_t(rootNode->get_pos()->variant());
+    header.isChess960 = rootNode->get_pos()->is_chess960();
+
+    // the tree is written to a new file, so that a memory mapping of the loaded file stays valid when it gets replaced
+    const string tmpFilename = filename + ".tmp";
+    ofstream file(tmpFilename, ios::binary);
+    if (!file) {
+        return 0;
+    }
+    string fenPadded = fen;
+    fenPadded.resize(get_fen_size(fen.size()), '\0');
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(fenPadded.data(), fenPadded.size());
+    file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(TreeNodeRecord));
+    file.close();
+    if (!file.good()) {
+        remove(tmpFilename.c_str());
+        return 0;
+    }
+#ifdef _WIN32
+    remove(filename.c_str());
+#endif
+    if (rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+        remove(tmpFilename.c_str());
+        return 0;
+    }
+    return records.size();
+}
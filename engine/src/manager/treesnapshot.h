@@ -0,0 +1,146 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: treesnapshot.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Binary snapshot format of a search tree which can be stored on disk and loaded again via a memory mapping.
+ * The nodes are stored in breadth-first order and reference their child nodes by index, which makes the format relocatable.
+ * All child nodes of a node are stored consecutively. The file is written in the native byte order.
+ * Layout: TreeFileHeader | FEN of the root position (padded to 8 bytes) | TreeNodeRecord[numberRecords]
+ */
+
+#ifndef TREESNAPSHOT_H
+#define TREESNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "types.h"
+
+using namespace std;
+
+class Node;
+
+const char TREE_FILE_MAGIC[8] = {'C', 'A', 'T', 'R', 'E', 'E', '\0', '\0'};
+const uint32_t TREE_FILE_VERSION = 1;
+
+// flags of a TreeNodeRecord
+const uint8_t RECORD_EXPANDED = 1;
+const uint8_t RECORD_TERMINAL = 2;
+const uint8_t RECORD_NN_RESULTS = 4;
+
+struct TreeFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t fenLength;
+    uint64_t rootKey;
+    uint64_t numberRecords;
+    int32_t variant;
+    uint32_t isChess960;
+};
+
+struct TreeNodeRecord
+{
+    uint32_t move;
+    float probValue;
+    float visits;
+    float actionValue;
+    float qValue;
+    // value of the neural network or of the terminal position
+    float value;
+    // index of the first child record, only valid if numberChildNodes > 0
+    uint32_t firstChildIdx;
+    uint16_t numberChildNodes;
+    uint8_t flags;
+    uint8_t padding;
+};
+
+static_assert(sizeof(TreeFileHeader) == 40, "unexpected padding of TreeFileHeader");
+static_assert(sizeof(TreeNodeRecord) == 32, "unexpected padding of TreeNodeRecord");
+
+class TreeSnapshot
+{
+private:
+    // memory of the whole file
+    const char* data;
+    size_t dataSize;
+#ifdef _WIN32
+    // the file is read into memory on platforms without mmap
+    vector<char> buffer;
+#endif
+    const TreeFileHeader* header;
+    const TreeNodeRecord* records;
+    string fen;
+
+    /**
+     * @brief is_valid Checks the header and the size of the file
+     * @return True, if the file can be used
+     */
+    bool is_valid() const;
+
+    /**
+     * @brief close Releases the memory mapping
+     */
+    void close();
+
+public:
+    TreeSnapshot();
+    ~TreeSnapshot();
+
+    /**
+     * @brief open Maps the given tree file into memory. The records are only read when the corresponding nodes are materialized.
+     * @param filename File which has been written by save_tree()
+     * @return True on success
+     */
+    bool open(const string& filename);
+
+    /**
+     * @brief get_record Returns the record of the given index
+     */
+    const TreeNodeRecord& get_record(uint32_t idx) const;
+
+    /**
+     * @brief has_valid_children Checks if the child indices of the given record are within the file.
+     * The records are stored in breadth-first order, so the child nodes must follow their parent, which also excludes cycles.
+     * @param idx Record index
+     */
+    bool has_valid_children(uint32_t idx) const;
+
+    uint64_t get_number_records() const;
+    const string& get_fen() const;
+    Key get_root_key() const;
+    Variant get_variant() const;
+    bool is_chess960() const;
+};
+
+/**
+ * @brief save_tree Stores the tree below the given root node in the snapshot format.
+ * Nodes which haven't been materialized from a previously loaded snapshot are copied from that snapshot.
+ * @param rootNode Root node of the tree
+ * @param filename Output file
+ * @return Number of stored nodes, 0 on failure
+ */
+size_t save_tree(const Node* rootNode, const string& filename);
+
+#endif // TREESNAPSHOT_H
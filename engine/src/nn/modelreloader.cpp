@@ -0,0 +1,142 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: modelreloader.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "modelreloader.h"
+#include <chrono>
+
+ModelReloader::ModelReloader(const vector<NeuralNetAPI*>& nets, const string& modelDirectory):
+    nets(nets),
+    modelDirectory(modelDirectory),
+    modificationTime(0),
+    isWatching(false)
+{
+    string jsonFilePath;
+    struct stat buffer;
+    if (get_model_files(modelDirectory, jsonFilePath, parameterFilePath) && stat(parameterFilePath.c_str(), &buffer) == 0) {
+        modificationTime = buffer.st_mtime;
+    }
+}
+
+ModelReloader::~ModelReloader()
+{
+    {
+        lock_guard<mutex> lock(watchMtx);
+        isWatching = false;
+    }
+    cvWatch.notify_one();
+    if (watcher.joinable()) {
+        watcher.join();
+    }
+    if (loader.joinable()) {
+        loader.join();
+    }
+}
+
+bool ModelReloader::load_parameters(const string& directory)
+{
+    string jsonFilePath;
+    string newParameterFilePath;
+    struct stat buffer;
+    if (!get_model_files(directory, jsonFilePath, newParameterFilePath) || stat(newParameterFilePath.c_str(), &buffer) != 0) {
+        cout << "info string The given directory at " << directory << " doesn't contain a .json and a .params file." << endl;
+        return false;
+    }
+    cout << "info string Loading the model parameters from " << newParameterFilePath << endl;
+    map<string, NDArray> parameters;
+    NDArray::Load(newParameterFilePath, 0, &parameters);
+    // all networks are validated first, so that the group is never left with a mix of old and new parameters
+    for (NeuralNetAPI* net : nets) {
+        if (!net->can_set_parameters(parameters)) {
+            cout << "info string Keeping the current model parameters" << endl;
+            return false;
+        }
+    }
+    for (NeuralNetAPI* net : nets) {
+        net->set_parameters(parameters);
+    }
+    modelDirectory = directory;
+    parameterFilePath = newParameterFilePath;
+    modificationTime = buffer.st_mtime;
+    cout << "info string Swapped in the model parameters of " << parameterFilePath << endl;
+    return true;
+}
+
+bool ModelReloader::reload(const string& directory)
+{
+    lock_guard<mutex> lock(reloadMtx);
+    return load_parameters(directory);
+}
+
+void ModelReloader::reload_async(const string& directory)
+{
+    if (loader.joinable()) {
+        loader.join();
+    }
+    loader = thread(&ModelReloader::reload, this, directory);
+}
+
+void ModelReloader::watch(double interval)
+{
+    {
+        lock_guard<mutex> lock(watchMtx);
+        if (isWatching) {
+            return;
+        }
+        isWatching = true;
+    }
+    watcher = thread(&ModelReloader::run_watcher, this, interval);
+}
+
+void ModelReloader::run_watcher(double interval)
+{
+    // parameter file which has been seen at the last check but hasn't been loaded yet
+    string pendingFilePath;
+    time_t pendingModificationTime = 0;
+    off_t pendingSize = -1;
+
+    unique_lock<mutex> watchLock(watchMtx);
+    while (!cvWatch.wait_for(watchLock, chrono::duration<double>(interval), [this]{ return !isWatching; })) {
+        lock_guard<mutex> lock(reloadMtx);
+        string jsonFilePath;
+        string newParameterFilePath;
+        struct stat buffer;
+        if (!get_model_files(modelDirectory, jsonFilePath, newParameterFilePath) || stat(newParameterFilePath.c_str(), &buffer) != 0 ||
+                (newParameterFilePath == parameterFilePath && buffer.st_mtime == modificationTime)) {
+            continue;
+        }
+        if (newParameterFilePath != pendingFilePath || buffer.st_mtime != pendingModificationTime || buffer.st_size != pendingSize) {
+            pendingFilePath = newParameterFilePath;
+            pendingModificationTime = buffer.st_mtime;
+            pendingSize = buffer.st_size;
+            continue;
+        }
+        if (!load_parameters(modelDirectory)) {
+            // the file isn't retried until it changes again
+            parameterFilePath = newParameterFilePath;
+            modificationTime = buffer.st_mtime;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: modelreloader.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * The model reloader loads new parameters of a model directory in a background thread and hands them over to
+ * a group of networks with the same architecture. Each network swaps in the new weights before its next prediction,
+ * so that running searches and self play games continue with the new model. Optionally, the model directory is
+ * polled for a new parameter file.
+ */
+
+#ifndef MODELRELOADER_H
+#define MODELRELOADER_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include "neuralnetapi.h"
+
+class ModelReloader
+{
+private:
+    vector<NeuralNetAPI*> nets;
+    string modelDirectory;
+    // parameter file which has been loaded last together with its modification time
+    string parameterFilePath;
+    time_t modificationTime;
+    // serializes the reloads and protects the members above
+    mutex reloadMtx;
+    // thread of the last reload_async() call
+    thread loader;
+
+    thread watcher;
+    mutex watchMtx;
+    condition_variable cvWatch;
+    bool isWatching;
+
+    /**
+     * @brief load_parameters Loads the newest parameter file of the given directory and sets it for all networks.
+     * The parameters are only set if every network accepts them, otherwise all networks keep their current parameters.
+     * It must be called while holding reloadMtx.
+     * @param directory Model directory
+     * @return True, if all networks accepted the parameters
+     */
+    bool load_parameters(const string& directory);
+
+    /**
+     * @brief run_watcher Main loop of the watcher thread which reloads the model when a new parameter file appears
+     * @param interval Time between two checks in seconds
+     */
+    void run_watcher(double interval);
+
+public:
+    /**
+     * @brief ModelReloader
+     * @param nets Networks which receive the new parameters, they must outlive the reloader
+     * @param modelDirectory Directory from which the networks have been loaded
+     */
+    ModelReloader(const vector<NeuralNetAPI*>& nets, const string& modelDirectory);
+
+    /**
+     * @brief ~ModelReloader Waits for a running reload and stops the watcher thread
+     */
+    ~ModelReloader();
+
+    /**
+     * @brief reload Loads the parameters of the given model directory and hands them over to the networks.
+     * The networks use the new parameters starting with their next prediction.
+     * @param directory Model directory, the architecture must be the same as the one of the loaded model
+     * @return True on success
+     */
+    bool reload(const string& directory);
+
+    /**
+     * @brief reload_async Runs reload() in a background thread and returns immediately
+     * @param directory Model directory
+     */
+    void reload_async(const string& directory);
+
+    /**
+     * @brief watch Starts a background thread which checks the model directory for a new parameter file in the given interval.
+     * A new file is only loaded after it stayed unchanged for one interval, so that a file which is still written is skipped.
+     * @param interval Time between two checks in seconds
+     */
+    void watch(double interval);
+};
+
+#endif // MODELRELOADER_H
@@ -45,9 +45,69 @@ vector<string> get_directory_files(const string& dir) {
     }
     return files;
 }
+
+/**
+ * @brief has_same_shapes Checks if two parameter maps contain the same parameter names with the same shapes
+ */
+bool has_same_shapes(const map<string, NDArray>& parameters, const map<string, NDArray>& referenceParameters)
+{
+    if (parameters.size() != referenceParameters.size()) {
+        return false;
+    }
+    for (const auto& pair : parameters) {
+        auto it = referenceParameters.find(pair.first);
+        if (it == referenceParameters.end() || it->second.GetShape() != pair.second.GetShape()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief split_parameter_names Splits a loaded parameter map into the arg and aux parameters without copying the arrays
+ */
+void split_parameter_names(const map<string, NDArray>& parameters, map<string, NDArray>& args, map<string, NDArray>& aux)
+{
+    for (const auto& pair : parameters) {
+        const string type = pair.first.substr(0, 4);
+        if (type == "arg:") {
+            args[pair.first.substr(4)] = pair.second;
+        }
+        else if (type == "aux:") {
+            aux[pair.first.substr(4)] = pair.second;
+        }
+    }
+}
 }  // namespace
 
+bool get_model_files(const string& modelDirectory, string& jsonFilePath, string& parameterFilePath)
+{
+    jsonFilePath = "";
+    parameterFilePath = "";
+    time_t parameterModificationTime = 0;
+
+    const vector<string>& files = get_directory_files(modelDirectory);
+    for (const string& file : files) {
+        size_t pos_json = file.find(".json");
+        size_t pos_params = file.find(".params");
+        if (pos_json != string::npos) {
+            jsonFilePath = modelDirectory + file;
+        }
+        else if (pos_params != string::npos) {
+            struct stat buffer;
+            if (stat((modelDirectory + file).c_str(), &buffer) == 0 &&
+                    (parameterFilePath == "" || buffer.st_mtime > parameterModificationTime)) {
+                parameterFilePath = modelDirectory + file;
+                parameterModificationTime = buffer.st_mtime;
+            }
+        }
+    }
+    return jsonFilePath != "" && parameterFilePath != "";
+}
+
 NeuralNetAPI::NeuralNetAPI(const string& ctx, unsigned int batchSize, const string& modelDirectory, bool enableTensorrt):
+    hasNewParameters(false),
+    parameterVersion(0),
     batchSize(batchSize),
     enableTensorrt(enableTensorrt)
 {
@@ -62,27 +122,17 @@ NeuralNetAPI::NeuralNetAPI(const string& ctx, unsigned int batchSize, const stri
     string jsonFilePath;
     string paramterFilePath;
 
-    const vector<string>& files = get_directory_files(modelDirectory);
-    for (const string& file : files) {
-        size_t pos_json = file.find(".json");
-        size_t pos_params = file.find(".params");
-        if (pos_json != string::npos) {
-            jsonFilePath = modelDirectory + file;
-        }
-        else if (pos_params != string::npos) {
-            paramterFilePath = modelDirectory + file;
-        }
-    }
-    if (jsonFilePath == "" || paramterFilePath == "") {
+    if (!get_model_files(modelDirectory, jsonFilePath, paramterFilePath)) {
         throw invalid_argument( "The given directory at " + modelDirectory
                                      + " doesn't contain a .json and a .params file.");
     }
 	cout << "info string json file: " << jsonFilePath << endl;
 
-    inputShape =  Shape(batchSize, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH);
     load_model(jsonFilePath);
     load_parameters(paramterFilePath);
-    bind_executor();
+    bind_executors();
+    allocate_input_buffer();
+    allocate_output_buffers();
     check_if_policy_map();
 }
 
@@ -91,6 +141,11 @@ bool NeuralNetAPI::is_policy_map() const
     return isPolicyMap;
 }
 
+size_t NeuralNetAPI::get_parameter_version() const
+{
+    return parameterVersion;
+}
+
 bool NeuralNetAPI::file_exists(const string &name)
 {
     struct stat buffer;
@@ -161,77 +216,183 @@ void NeuralNetAPI::load_parameters(const string& paramterFilePath) {
     NDArray::WaitAll();
 }
 
-void NeuralNetAPI::bind_executor()
+Executor* NeuralNetAPI::bind_executor(unsigned int executorBatchSize)
 {
     // Create an executor after binding the model to input parameters.
-    argsMap["data"] = NDArray(inputShape, globalCtx, false);
+    // The weights in argsMap and auxMap are shared by all executors.
+    map<string, NDArray> executorArgsMap = argsMap;
+    // the input array is a view on the leading rows of the shared input array
+    inputDataSlices.push_back(inputData.Slice(0, executorBatchSize));
+    executorArgsMap["data"] = inputDataSlices.back();
     /* new */
     vector<NDArray> argArrays;
     vector<NDArray> gradArrays;
     vector<OpReqType> gradReqs;
     vector<NDArray> auxArrays;
-    Shape value_label_shape(inputShape[0]);
-    Shape policy_label_shape(inputShape[0]);
+    Shape value_label_shape(executorBatchSize);
+    Shape policy_label_shape(executorBatchSize);
 
-    argsMap["value_label"] = NDArray(value_label_shape, globalCtx, false);
-    argsMap["policy_label"] = NDArray(policy_label_shape, globalCtx, false);
+    executorArgsMap["value_label"] = NDArray(value_label_shape, globalCtx, false);
+    executorArgsMap["policy_label"] = NDArray(policy_label_shape, globalCtx, false);
 
     net.InferExecutorArrays(globalCtx, &argArrays, &gradArrays, &gradReqs,
-                            &auxArrays, argsMap, map<string, NDArray>(),
+                            &auxArrays, executorArgsMap, map<string, NDArray>(),
                             map<string, OpReqType>(), auxMap);
     for (size_t i = 0; i < gradReqs.size(); ++i) {
         gradReqs[i] = kNullOp;
     }
 
-    executor = new Executor(net, globalCtx, argArrays, gradArrays, gradReqs, auxArrays);
-	cout << "info string Bind successfull!" << endl;
+    Executor* executor = new Executor(net, globalCtx, argArrays, gradArrays, gradReqs, auxArrays);
+    cout << "info string Bind successfull for batch size " << executorBatchSize << "!" << endl;
+    return executor;
 }
 
-void NeuralNetAPI::check_if_policy_map()
+void NeuralNetAPI::bind_executors()
 {
-    float* inputPlanes = new float[batchSize*NB_VALUES_TOTAL];
-    fill(inputPlanes, inputPlanes+batchSize*NB_VALUES_TOTAL, 0.0f);
+    executorBatchSizes.push_back(1);
+    for (unsigned int curBatchSize = 4; curBatchSize < batchSize; curBatchSize *= 2) {
+        executorBatchSizes.push_back(curBatchSize);
+    }
+    if (batchSize > 1) {
+        executorBatchSizes.push_back(batchSize);
+    }
+    inputData = NDArray(Shape(batchSize, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH), globalCtx, false);
+    for (unsigned int executorBatchSize : executorBatchSizes) {
+        executors.push_back(bind_executor(executorBatchSize));
+    }
+}
 
-    float value;
-    NDArray probOutputs = predict(inputPlanes, value);
-    isPolicyMap = probOutputs.GetShape()[1] != NB_LABELS;
-    cout << "info string isPolicyMap: " << isPolicyMap << endl;
-    delete[] inputPlanes;
+void NeuralNetAPI::allocate_output_buffers()
+{
+    if (globalCtx.GetDeviceType() != Context::cpu().GetDeviceType()) {
+        for (Executor* executor : executors) {
+            valueOutputsCPU.push_back(NDArray(Shape(executor->outputs[0].GetShape()), Context::cpu(), false));
+            probOutputsCPU.push_back(NDArray(Shape(executor->outputs[1].GetShape()), Context::cpu(), false));
+        }
+    }
 }
 
-NDArray NeuralNetAPI::predict(float *inputPlanes, float &value)
+void NeuralNetAPI::allocate_input_buffer()
 {
-    executor->arg_dict()["data"].SyncCopyFromCPU(inputPlanes, NB_VALUES_TOTAL * batchSize);
+    if (globalCtx.GetDeviceType() == Context::cpu().GetDeviceType()) {
+        // the planes are encoded directly into the memory of the executors
+        inputPlanes = const_cast<float*>(inputData.GetData());
+    }
+    else {
+        inputPlanesHost = NDArray(Shape(batchSize, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH), Context(kCPUPinned, 0), false);
+        for (unsigned int executorBatchSize : executorBatchSizes) {
+            inputPlanesHostSlices.push_back(inputPlanesHost.Slice(0, executorBatchSize));
+        }
+        inputPlanes = const_cast<float*>(inputPlanesHost.GetData());
+    }
+    fill(inputPlanes, inputPlanes+NB_VALUES_TOTAL*batchSize, 0.0f);
+}
 
-    // Run the forward pass.
-    executor->Forward(false);
+float* NeuralNetAPI::get_input_planes() const
+{
+    return inputPlanes;
+}
+
+size_t NeuralNetAPI::get_executor_idx(unsigned int nbSamples) const
+{
+    for (size_t idx = 0; idx < executorBatchSizes.size(); ++idx) {
+        if (nbSamples <= executorBatchSizes[idx]) {
+            return idx;
+        }
+    }
+    return executorBatchSizes.size() - 1;
+}
 
-    auto valueOutput = executor->outputs[0].Copy(Context::cpu());
-    auto probOutputs = executor->outputs[1].Copy(Context::cpu());
+void NeuralNetAPI::check_if_policy_map()
+{
+    isPolicyMap = executors.front()->outputs[1].GetShape()[1] != NB_LABELS;
+    cout << "info string isPolicyMap: " << isPolicyMap << endl;
+}
 
-    // Assign the value output to the return paramter
-    valueOutput.WaitToRead();
-    value = valueOutput.At(0, 0);
+bool NeuralNetAPI::can_set_parameters(const map<string, NDArray>& parameters) const
+{
+    if (enableTensorrt) {
+        cout << "info string Replacing the parameters isn't supported with TensorRT" << endl;
+        return false;
+    }
+    map<string, NDArray> args;
+    map<string, NDArray> aux;
+    split_parameter_names(parameters, args, aux);
+    // argsMap and auxMap are never reassigned after construction and can be read without the lock
+    if (!has_same_shapes(args, argsMap) || !has_same_shapes(aux, auxMap)) {
+        cout << "info string The new parameters don't match the architecture of the loaded model" << endl;
+        return false;
+    }
+    return true;
+}
 
-    probOutputs.WaitToRead();
+bool NeuralNetAPI::set_parameters(const map<string, NDArray>& parameters)
+{
+    if (!can_set_parameters(parameters)) {
+        return false;
+    }
+    map<string, NDArray> args;
+    map<string, NDArray> aux;
+    SplitParamMap(parameters, &args, &aux, globalCtx);
+    // the copies into the computation context are finished before the parameters are handed over
+    for (const auto& pair : args) {
+        pair.second.WaitToRead();
+    }
+    for (const auto& pair : aux) {
+        pair.second.WaitToRead();
+    }
 
-    auto predicted = probOutputs.ArgmaxChannel();
-    predicted.WaitToRead();
+    lock_guard<mutex> lock(mtx);
+    newArgsMap = std::move(args);
+    newAuxMap = std::move(aux);
+    hasNewParameters = true;
+    ++parameterVersion;
+    return true;
+}
 
-    return probOutputs;
+void NeuralNetAPI::apply_new_parameters()
+{
+    lock_guard<mutex> lock(mtx);
+    // the executors were bound to the arrays of argsMap and auxMap, so the weights are overwritten in place
+    for (const auto& pair : newArgsMap) {
+        pair.second.CopyTo(&argsMap[pair.first]);
+    }
+    for (const auto& pair : newAuxMap) {
+        pair.second.CopyTo(&auxMap[pair.first]);
+    }
+    newArgsMap.clear();
+    newAuxMap.clear();
+    hasNewParameters = false;
 }
 
-void NeuralNetAPI::predict(float *inputPlanes, NDArray &valueOutput, NDArray &probOutputs)
+void NeuralNetAPI::predict(unsigned int nbSamples, const float*& valueOutput, const float*& probOutputs)
 {
-    executor->arg_dict()["data"].SyncCopyFromCPU(inputPlanes, NB_VALUES_TOTAL * batchSize);
+    if (hasNewParameters) {
+        apply_new_parameters();
+    }
+    const size_t executorIdx = get_executor_idx(nbSamples);
+    Executor* executor = executors[executorIdx];
+    if (globalCtx.GetDeviceType() != Context::cpu().GetDeviceType()) {
+        // only copy the rows which are used by the executor
+        inputPlanesHostSlices[executorIdx].CopyTo(&inputDataSlices[executorIdx]);
+    }
 
     // Run the forward pass.
     executor->Forward(false);
 
-    valueOutput = executor->outputs[0].Copy(Context::cpu());
-    probOutputs = executor->outputs[1].Copy(Context::cpu());
-
-    // Assign the value output to the return paramter
-    valueOutput.WaitToRead();
-    probOutputs.WaitToRead();
+    if (globalCtx.GetDeviceType() == Context::cpu().GetDeviceType()) {
+        // the outputs already reside in main memory and can be read directly
+        executor->outputs[0].WaitToRead();
+        executor->outputs[1].WaitToRead();
+        valueOutput = executor->outputs[0].GetData();
+        probOutputs = executor->outputs[1].GetData();
+        return;
+    }
+    // copy into the preallocated main memory buffers
+    executor->outputs[0].CopyTo(&valueOutputsCPU[executorIdx]);
+    executor->outputs[1].CopyTo(&probOutputsCPU[executorIdx]);
+    valueOutputsCPU[executorIdx].WaitToRead();
+    probOutputsCPU[executorIdx].WaitToRead();
+    valueOutput = valueOutputsCPU[executorIdx].GetData();
+    probOutputs = probOutputsCPU[executorIdx].GetData();
 }
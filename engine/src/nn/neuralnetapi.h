@@ -33,21 +33,51 @@
 #include <iostream>
 #include <sys/stat.h>
 #include <mutex>
+#include <atomic>
 #include "mxnet-cpp/MxNetCpp.h"
 
 using namespace mxnet::cpp;
 using namespace std;
 
+/**
+ * @brief get_model_files Looks up the network architecture (.json file) and the parameters (.params file) in the given directory.
+ * If the directory contains several parameter files, the most recently modified one is used.
+ * @param modelDirectory Directory of the model
+ * @param jsonFilePath Output path of the architecture file
+ * @param parameterFilePath Output path of the parameter file
+ * @return True, if both files have been found
+ */
+bool get_model_files(const string& modelDirectory, string& jsonFilePath, string& parameterFilePath);
+
 class NeuralNetAPI
 {
 private:
+    // protects the new parameters which are waiting to be copied into the executors
     std::mutex mtx;
     std::map<std::string, NDArray> argsMap;
     std::map<std::string, NDArray> auxMap;
+    // parameters which have been set by set_parameters() and are copied into argsMap and auxMap before the next prediction
+    std::map<std::string, NDArray> newArgsMap;
+    std::map<std::string, NDArray> newAuxMap;
+    atomic<bool> hasNewParameters;
+    // incremented every time new parameters are set
+    atomic<size_t> parameterVersion;
     std::vector<std::string> outputLabels;
     Symbol net;
-    Executor *executor;
-    Shape inputShape;
+    // executors for different batch sizes which share the same weights, sorted by ascending batch size
+    vector<Executor*> executors;
+    vector<unsigned int> executorBatchSizes;
+    // main memory mirrors of the executor outputs which are only used if the network doesn't run on the CPU
+    vector<NDArray> valueOutputsCPU;
+    vector<NDArray> probOutputsCPU;
+    // input array for the full batch in the computation context, the executors are bound to the leading rows of it
+    NDArray inputData;
+    vector<NDArray> inputDataSlices;
+    // pinned main memory buffer for the input planes which is only used if the network doesn't run on the CPU
+    NDArray inputPlanesHost;
+    vector<NDArray> inputPlanesHostSlices;
+    // memory in which the input planes are written, it either belongs to inputData or inputPlanesHost
+    float* inputPlanes;
     Context globalCtx = Context::cpu();
     unsigned int batchSize;
     bool isPolicyMap;
@@ -73,9 +103,36 @@ private:
     void load_parameters(const std::string& paramterFilePath);
 
     /**
-     * @brief bind_executor Binds the executor object to the neural network
+     * @brief bind_executor Binds a new executor object to the neural network for the given batch size
+     * @param executorBatchSize Batch size of the executor
+     * @return Pointer to the new executor
+     */
+    Executor* bind_executor(unsigned int executorBatchSize);
+
+    /**
+     * @brief bind_executors Binds an executor for every batch size of the form 1, 4, 8, 16, ... which is smaller than the
+     * maximum batch size and one for the maximum batch size itself
+     */
+    void bind_executors();
+
+    /**
+     * @brief allocate_output_buffers Allocates persistent main memory buffers for the network outputs in case the
+     * computation context isn't the CPU. This avoids allocating new NDArrays for every prediction.
+     */
+    void allocate_output_buffers();
+
+    /**
+     * @brief allocate_input_buffer Sets the memory for the input planes. On the CPU the planes are directly written into
+     * the input array of the executors. Otherwise a pinned main memory buffer is allocated.
      */
-    void bind_executor();
+    void allocate_input_buffer();
+
+    /**
+     * @brief get_executor_idx Returns the index of the smallest executor which can evaluate the given number of samples
+     * @param nbSamples Number of samples to evaluate
+     * @return Executor index
+     */
+    size_t get_executor_idx(unsigned int nbSamples) const;
 
     /**
      * @brief infer_select_policy_from_planes Checks if the loaded model encodes the policy as planes
@@ -105,33 +162,57 @@ private:
         std::map<std::string, NDArray> *paramMapInTargetContext,
         Context targetContext);
 
+    /**
+     * @brief apply_new_parameters Copies the new parameters into the weight arrays which are shared by all executors.
+     * It is called by predict(), so that the parameters never change during a forward pass.
+     */
+    void apply_new_parameters();
+
 public:
     /**
      * @brief NeuralNetAPI
      * @param ctx Computation contex either "cpu" or "gpu"
-     * @param batchSize Constant batch size which is used for inference
+     * @param batchSize Maximum batch size which is used for inference
      * @param modelDirectory Directory where the network architecture is stored (.json file) and
      * where parameters a.k.a weights of the neural are stored (.params file) are stored
      */
     NeuralNetAPI(const string& ctx, unsigned int batchSize, const string& modelDirectory, bool enableTensorrt);
 
     /**
-     * @brief predict Runs a prediction on the given inputPlanes and returns the policy vector in form of a NDArray and the value as a float number
-     * @param inputPlanes Pointer to the input planes of a single board position
-     * @param value Value prediction for the board by the neural network
-     * @return Policy NDArray
+     * @brief get_input_planes Returns the memory in which the input planes for the next prediction must be written.
+     * It holds NB_VALUES_TOTAL values for each of the batchSize samples.
+     * @return Pointer to the input planes
+     */
+    float* get_input_planes() const;
+
+    /**
+     * @brief predict Runs a prediction on the input planes and exposes read-only views of the value and policy outputs.
+     * No memory is allocated, the input isn't copied and the policy isn't copied if the network runs on the CPU.
+     * The views stay valid until the next call of predict() on the same object.
+     * @param nbSamples Number of valid samples in the input planes. The smallest bound executor which fits this number is used.
+     * @param valueOutput Output pointer to the value predictions with one entry per batch element
+     * @param probOutputs Output pointer to the raw policy predictions (including illegal moves) of shape [nbSamples, nbPolicyValues]
+     */
+    void predict(unsigned int nbSamples, const float*& valueOutput, const float*& probOutputs);
+
+    /**
+     * @brief can_set_parameters Checks if set_parameters() would accept the given parameters without changing the network
+     * @param parameters Parameter map as loaded from a .params file
+     * @return True, if the network supports replacing its parameters and the parameters match its architecture
      */
-    NDArray predict(float *inputPlanes, float &value);
+    bool can_set_parameters(const std::map<std::string, NDArray>& parameters) const;
 
     /**
-     * @brief predict Runs a prediction on the given inputPlanes and returns the policy vector in form of a NDArray and the value as a float number
-     * @param inputPlanes Pointer to the input planes of a single board position
-     * @param value Value prediction for the board by the neural network
-     * @param probOutputs Policy NDArray of the raw network output (including illegal moves). It's assumend that the memory has already been allocated.
+     * @brief set_parameters Replaces the parameters a.k.a weights of the network without rebinding the executors.
+     * The parameters are copied into the computation context by the calling thread and take effect with the next prediction.
+     * This function can be called while another thread runs predictions.
+     * @param parameters Parameter map as loaded from a .params file, the architecture must be the same as the one of the network
+     * @return True, if the parameters match the network and have been accepted
      */
-    void predict(float *inputPlanes, NDArray &valueOutput, NDArray &probOutputs);
+    bool set_parameters(const std::map<std::string, NDArray>& parameters);
 
     bool is_policy_map() const;
+    size_t get_parameter_version() const;
 };
 
 #endif // NEURALNETAPI_H
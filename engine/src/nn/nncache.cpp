@@ -0,0 +1,137 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: nncache.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "nncache.h"
+#include <cmath>
+
+// scaling factor for converting probabilities in [0,1] to 16 bit integers
+const float PRIOR_QUANTIZATION = 65535.0f;
+
+NNCacheEntry::NNCacheEntry():
+    key(0),
+    rule50(0),
+    repetition(0),
+    value(0.0f),
+    isUsed(false)
+{
+}
+
+NNCache::NNCache(size_t numberEntries):
+    entries(numberEntries),
+    lookups(0),
+    hits(0)
+{
+}
+
+size_t NNCache::get_entry_idx(Key key) const
+{
+    return key % entries.size();
+}
+
+bool NNCache::probe(const Board *pos, size_t numberMoves, float &value, DynamicVector<float> &policyProbSmall)
+{
+    if (!is_enabled()) {
+        return false;
+    }
+    ++lookups;
+    const Key key = pos->hash_key();
+    const size_t idx = get_entry_idx(key);
+    lock_guard<mutex> lock(mtx[idx % NB_CACHE_STRIPES]);
+    const NNCacheEntry& entry = entries[idx];
+    if (!entry.isUsed || entry.key != key ||
+            entry.rule50 != pos->getStateInfo()->rule50 ||
+            entry.repetition != pos->getStateInfo()->repetition ||
+            entry.priors.size() != numberMoves) {
+        return false;
+    }
+    value = entry.value;
+    policyProbSmall.resize(numberMoves);
+    for (size_t i = 0; i < numberMoves; ++i) {
+        policyProbSmall[i] = entry.priors[i] / PRIOR_QUANTIZATION;
+    }
+    ++hits;
+    return true;
+}
+
+void NNCache::store(const Board *pos, float value, const DynamicVector<float> &policyProbSmall)
+{
+    if (!is_enabled()) {
+        return;
+    }
+    const Key key = pos->hash_key();
+    const size_t idx = get_entry_idx(key);
+    lock_guard<mutex> lock(mtx[idx % NB_CACHE_STRIPES]);
+    NNCacheEntry& entry = entries[idx];
+    entry.key = key;
+    entry.rule50 = pos->getStateInfo()->rule50;
+    entry.repetition = pos->getStateInfo()->repetition;
+    entry.value = value;
+    // the capacity of the vector is reused when the entry is replaced
+    entry.priors.resize(policyProbSmall.size());
+    for (size_t i = 0; i < policyProbSmall.size(); ++i) {
+        entry.priors[i] = uint16_t(std::round(std::min(std::max(policyProbSmall[i], 0.0f), 1.0f) * PRIOR_QUANTIZATION));
+    }
+    entry.isUsed = true;
+}
+
+void NNCache::clear()
+{
+    for (size_t stripe = 0; stripe < NB_CACHE_STRIPES; ++stripe) {
+        lock_guard<mutex> lock(mtx[stripe]);
+        for (size_t idx = stripe; idx < entries.size(); idx += NB_CACHE_STRIPES) {
+            entries[idx].isUsed = false;
+        }
+    }
+    reset_statistics();
+}
+
+void NNCache::reset_statistics()
+{
+    lookups = 0;
+    hits = 0;
+}
+
+bool NNCache::is_enabled() const
+{
+    return entries.size() != 0;
+}
+
+size_t NNCache::get_lookups() const
+{
+    return lookups;
+}
+
+size_t NNCache::get_hits() const
+{
+    return hits;
+}
+
+float NNCache::get_hit_rate() const
+{
+    if (lookups == 0) {
+        return 0.0f;
+    }
+    return float(hits) / lookups;
+}
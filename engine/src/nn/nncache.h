@@ -0,0 +1,120 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: nncache.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Fixed-size cache for neural network evaluations which is independent of the search tree.
+ * It stores the value and the quantized prior policy of the legal moves for a position
+ * and keeps them alive after subtrees or the full game history have been deleted.
+ */
+
+#ifndef NNCACHE_H
+#define NNCACHE_H
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <blaze/Math.h>
+#include "../board.h"
+
+using blaze::DynamicVector;
+using namespace std;
+
+// number of mutexes which protect the cache entries, each mutex is responsible for every NB_CACHE_STRIPES-th entry
+const size_t NB_CACHE_STRIPES = 256;
+
+struct NNCacheEntry
+{
+    Key key;
+    int rule50;
+    int repetition;
+    float value;
+    // prior policy for all legal moves in move generation order, quantized to 16 bit
+    vector<uint16_t> priors;
+    bool isUsed;
+
+    NNCacheEntry();
+};
+
+class NNCache
+{
+private:
+    vector<NNCacheEntry> entries;
+    mutex mtx[NB_CACHE_STRIPES];
+    atomic<size_t> lookups;
+    atomic<size_t> hits;
+
+    /**
+     * @brief get_entry_idx Returns the entry index which belongs to a given hash key
+     * @param key Hash key of the position
+     * @return Entry index
+     */
+    inline size_t get_entry_idx(Key key) const;
+
+public:
+    /**
+     * @brief NNCache
+     * @param numberEntries Number of positions which can be stored at most. 0 disables the cache.
+     */
+    NNCache(size_t numberEntries);
+
+    /**
+     * @brief probe Looks up the neural network evaluation of the given position.
+     * A hit requires the same hash key, rule50 counter, repetition state and number of legal moves.
+     * @param pos Board position
+     * @param numberMoves Number of legal moves of the position
+     * @param value Output value evaluation
+     * @param policyProbSmall Output prior policy for all legal moves in move generation order
+     * @return True if the position was found
+     */
+    bool probe(const Board* pos, size_t numberMoves, float& value, DynamicVector<float>& policyProbSmall);
+
+    /**
+     * @brief store Stores the neural network evaluation of the given position and replaces any previous entry at the same slot
+     * @param pos Board position
+     * @param value Value evaluation
+     * @param policyProbSmall Prior policy for all legal moves in move generation order
+     */
+    void store(const Board* pos, float value, const DynamicVector<float>& policyProbSmall);
+
+    /**
+     * @brief clear Removes all entries and resets the statistics
+     */
+    void clear();
+
+    /**
+     * @brief reset_statistics Resets the number of lookups and hits
+     */
+    void reset_statistics();
+
+    bool is_enabled() const;
+    size_t get_lookups() const;
+    size_t get_hits() const;
+
+    /**
+     * @brief get_hit_rate Returns the number of hits divided by the number of lookups
+     * @return float in [0,1]
+     */
+    float get_hit_rate() const;
+};
+
+#endif // NNCACHE_H
@@ -0,0 +1,132 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: sharednetbatch.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "sharednetbatch.h"
+#include <cassert>
+#include "../domain/crazyhouse/constants.h"
+
+SharedNetBatch::SharedNetBatch(const string& ctx, size_t numberSlots, unsigned int slotBatchSize, const string& modelDirectory, bool enableTensorrt):
+    numberSlots(numberSlots),
+    slotBatchSize(slotBatchSize),
+    pendingSamples(numberSlots, 0),
+    activeSlots(numberSlots, false),
+    numberActiveSlots(0),
+    numberSubmittedSlots(0),
+    predictionCounter(0),
+    numberEvaluatedSamples(0),
+    batchCapacity(0),
+    valueOutput(nullptr),
+    probOutputs(nullptr)
+{
+    net = new NeuralNetAPI(ctx, numberSlots * slotBatchSize, modelDirectory, enableTensorrt);
+}
+
+SharedNetBatch::~SharedNetBatch()
+{
+    delete net;
+}
+
+float* SharedNetBatch::get_input_planes(size_t slotIdx) const
+{
+    return net->get_input_planes() + slotIdx * slotBatchSize * NB_VALUES_TOTAL;
+}
+
+void SharedNetBatch::activate_slot(size_t slotIdx)
+{
+    // the predictions run while holding the lock, so no prediction reads the input planes after this point
+    // until the slot has submitted its mini-batch
+    lock_guard<mutex> lock(mtx);
+    if (!activeSlots[slotIdx]) {
+        activeSlots[slotIdx] = true;
+        ++numberActiveSlots;
+    }
+}
+
+void SharedNetBatch::deactivate_slot(size_t slotIdx)
+{
+    lock_guard<mutex> lock(mtx);
+    if (activeSlots[slotIdx]) {
+        activeSlots[slotIdx] = false;
+        --numberActiveSlots;
+        // the remaining slots might only have been waiting for this one
+        predictionDone.notify_all();
+    }
+}
+
+void SharedNetBatch::predict(size_t slotIdx, unsigned int nbSamples, const float*& valueOutput, const float*& probOutputs)
+{
+    unique_lock<mutex> lock(mtx);
+    assert(activeSlots[slotIdx] && pendingSamples[slotIdx] == 0 && nbSamples <= slotBatchSize);
+    pendingSamples[slotIdx] = nbSamples;
+    ++numberSubmittedSlots;
+    const size_t prediction = predictionCounter;
+    predictionDone.wait(lock, [&]{ return predictionCounter != prediction || numberSubmittedSlots >= numberActiveSlots; });
+    if (predictionCounter == prediction) {
+        run_prediction();
+    }
+    valueOutput = this->valueOutput + slotIdx * slotBatchSize;
+    probOutputs = this->probOutputs + slotIdx * slotBatchSize * (net->is_policy_map() ? NB_LABELS_POLICY_MAP : NB_LABELS);
+}
+
+void SharedNetBatch::run_prediction()
+{
+    // the slots keep their fixed position in the batch, so the batch ends after the last submitted slot
+    unsigned int nbSamples = 0;
+    for (size_t slotIdx = 0; slotIdx < numberSlots; ++slotIdx) {
+        if (pendingSamples[slotIdx] != 0) {
+            nbSamples = slotIdx * slotBatchSize + pendingSamples[slotIdx];
+            numberEvaluatedSamples += pendingSamples[slotIdx];
+            pendingSamples[slotIdx] = 0;
+        }
+    }
+    net->predict(nbSamples, valueOutput, probOutputs);
+    batchCapacity += numberSlots * slotBatchSize;
+    numberSubmittedSlots = 0;
+    ++predictionCounter;
+    predictionDone.notify_all();
+}
+
+void SharedNetBatch::get_nn_statistics(size_t& evaluatedSamples, size_t& batchCapacity)
+{
+    lock_guard<mutex> lock(mtx);
+    evaluatedSamples = numberEvaluatedSamples;
+    batchCapacity = this->batchCapacity;
+}
+
+bool SharedNetBatch::is_policy_map() const
+{
+    return net->is_policy_map();
+}
+
+size_t SharedNetBatch::get_number_slots() const
+{
+    return numberSlots;
+}
+
+NeuralNetAPI* SharedNetBatch::get_net() const
+{
+    return net;
+}
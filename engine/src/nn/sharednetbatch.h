@@ -0,0 +1,126 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: sharednetbatch.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Network evaluator which combines the mini-batches of several independent searches into a single prediction.
+ * Every search thread owns a fixed slot of the full batch. A prediction is run as soon as every active slot has submitted
+ * its mini-batch, so that searches which don't fill a batch on their own still use the network efficiently.
+ */
+
+#ifndef SHAREDNETBATCH_H
+#define SHAREDNETBATCH_H
+
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include "neuralnetapi.h"
+
+class SharedNetBatch
+{
+private:
+    NeuralNetAPI* net;
+    size_t numberSlots;
+    unsigned int slotBatchSize;
+
+    mutex mtx;
+    condition_variable predictionDone;
+    // number of samples which each slot submitted for the next prediction, 0 if it hasn't submitted yet
+    vector<unsigned int> pendingSamples;
+    vector<bool> activeSlots;
+    size_t numberActiveSlots;
+    size_t numberSubmittedSlots;
+    // incremented after every prediction
+    size_t predictionCounter;
+    // number of evaluated samples and the number of samples which the full batches of all predictions could have held
+    size_t numberEvaluatedSamples;
+    size_t batchCapacity;
+
+    // read-only views on the outputs of the last prediction for the full batch
+    const float* valueOutput;
+    const float* probOutputs;
+
+    /**
+     * @brief run_prediction Evaluates the mini-batches of all submitted slots and wakes up the waiting slots.
+     * It must be called while holding the lock.
+     */
+    void run_prediction();
+
+public:
+    /**
+     * @brief SharedNetBatch
+     * @param ctx Computation contex either "cpu" or "gpu"
+     * @param numberSlots Number of search threads which share the network
+     * @param slotBatchSize Maximum mini-batch size of a single search thread
+     * @param modelDirectory Directory of the network architecture and parameters
+     * @param enableTensorrt Enables TensorRT for the network
+     */
+    SharedNetBatch(const string& ctx, size_t numberSlots, unsigned int slotBatchSize, const string& modelDirectory, bool enableTensorrt);
+    ~SharedNetBatch();
+
+    /**
+     * @brief get_input_planes Returns the memory in which the given slot must write the input planes of its mini-batch.
+     * The planes may only be written while the slot is active, since predictions cover the memory of all slots up to the last submitted one.
+     * @param slotIdx Slot index
+     * @return Pointer to slotBatchSize samples of NB_VALUES_TOTAL values
+     */
+    float* get_input_planes(size_t slotIdx) const;
+
+    /**
+     * @brief activate_slot Marks the slot as searching. Predictions wait for the mini-batches of all active slots.
+     * The call blocks while a prediction is running, so that the slot can write its input planes afterwards.
+     * @param slotIdx Slot index
+     */
+    void activate_slot(size_t slotIdx);
+
+    /**
+     * @brief deactivate_slot Marks the slot as idle, e.g. when the search is finished, so that the other slots don't wait for it
+     * @param slotIdx Slot index
+     */
+    void deactivate_slot(size_t slotIdx);
+
+    /**
+     * @brief predict Submits the mini-batch of the given slot and blocks until it has been evaluated.
+     * The last slot which submits runs the prediction for all slots.
+     * The views stay valid until the slot submits its next mini-batch or is deactivated.
+     * @param slotIdx Active slot index
+     * @param nbSamples Number of valid samples in the input planes of the slot
+     * @param valueOutput Output pointer to the value predictions of the slot
+     * @param probOutputs Output pointer to the raw policy predictions of the slot
+     */
+    void predict(size_t slotIdx, unsigned int nbSamples, const float*& valueOutput, const float*& probOutputs);
+
+    /**
+     * @brief get_nn_statistics Returns the fill of the actual batches of the shared network since it was created.
+     * It includes the root predictions of the agents.
+     * @param evaluatedSamples Number of evaluated samples of all slots
+     * @param batchCapacity Number of predictions times the number of slots times the slot batch size
+     */
+    void get_nn_statistics(size_t& evaluatedSamples, size_t& batchCapacity);
+
+    bool is_policy_map() const;
+    size_t get_number_slots() const;
+    NeuralNetAPI* get_net() const;
+};
+
+#endif // SHAREDNETBATCH_H
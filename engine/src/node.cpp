@@ -27,6 +27,8 @@
 #include "util/blazeutil.h" // get_dirichlet_noise()
 #include "constants.h"
 #include "../util/sfutil.h"
+#include "manager/treesnapshot.h"
+#include <limits>
 
 Node::Node(Node *parentNode, Move move,  SearchSettings* searchSettings):
     parentNode(parentNode),
@@ -44,10 +46,14 @@ Node::Node(Node *parentNode, Move move,  SearchSettings* searchSettings):
     isCalibrated(false),
     areChildNodesSorted(false),
     isFullyExpanded(false),
+    isCheckingMove(false),
+    isCaptureMove(false),
     uParentFactor(0.0f),
     uDivisorSummand(0.0f),
     checkmateNode(nullptr),
-    searchSettings(searchSettings)
+    searchSettings(searchSettings),
+    snapshot(nullptr),
+    snapshotIdx(0)
 {
 
 }
@@ -127,15 +133,23 @@ void Node::calibrate_child_node_order()
     //            }
 }
 
-void Node::expand()
+/**
+ * @brief The NodeExpansion struct calls the variant specialized Node::expand() for the variant dispatch
+ */
+struct NodeExpansion
 {
-    create_child_nodes();
-    numberChildNodes = childNodes.size();
-    check_for_terminal();
-    isExpanded = true;
-    if (parentNode != nullptr) {
-        parentNode->increment_no_visit_idx();
+    Node* node;
+
+    template<Variant variant>
+    void run() {
+        node->expand<variant>();
     }
+};
+
+void Node::expand()
+{
+    NodeExpansion functor = {this};
+    dispatch_variant(pos->variant(), functor);
 }
 
 Move Node::get_move() const
@@ -143,7 +157,7 @@ Move Node::get_move() const
     return move;
 }
 
-vector<Node*> Node::get_child_nodes() const
+const vector<Node*>& Node::get_child_nodes() const
 {
     return childNodes;
 }
@@ -158,6 +172,16 @@ bool Node::has_nn_results() const
     return hasNNResults;
 }
 
+bool Node::is_checking_move() const
+{
+    return isCheckingMove;
+}
+
+bool Node::is_capture_move() const
+{
+    return isCaptureMove;
+}
+
 Color Node::side_to_move() const
 {
     return pos->side_to_move();
@@ -292,51 +316,69 @@ SearchSettings* Node::get_search_settings() const
     return searchSettings;
 }
 
-void Node::check_for_terminal()
+void Node::set_snapshot_record(const TreeSnapshot* snapshot, uint32_t snapshotIdx)
 {
-    if (numberChildNodes == 0) {
-        isTerminal = true;
-#ifdef ANTI
-        if (pos->is_anti()) {
-            // a stalmate is a win in antichess
-            value = WIN;
-            return;
-        }
-#endif
-        // test if we have a check-mate
-        if (parentNode->pos->gives_check(move)) {
-            value = LOSS;
-            isTerminal = true;
-            parentNode->checkmateNode = this;
-            return;
-        }
-        // we reached a stalmate
-        value = DRAW;
-        return;
+    this->snapshot = snapshot;
+    this->snapshotIdx = snapshotIdx;
+}
+
+bool Node::has_snapshot_record() const
+{
+    return snapshot != nullptr;
+}
+
+const TreeSnapshot* Node::get_snapshot() const
+{
+    return snapshot;
+}
+
+uint32_t Node::get_snapshot_idx() const
+{
+    return snapshotIdx;
+}
+
+void Node::restore_from_snapshot()
+{
+    const TreeNodeRecord& record = snapshot->get_record(snapshotIdx);
+    if (parentNode == nullptr) {
+        visits = record.visits;
+        actionValue = record.actionValue;
+        qValue = record.qValue;
+    }
+    if (!isTerminal) {
+        value = record.value;
+        hasNNResults = record.flags & RECORD_NN_RESULTS;
     }
-#ifdef ANTI
-    if (pos->is_anti()) {
-        if (pos->is_anti_win()) {
-            isTerminal = true;
-            value = WIN;
-            return;
+
+    if (snapshot->has_valid_children(snapshotIdx)) {
+        // the child nodes might have been generated in a different order
+        unordered_map<uint32_t, uint32_t> childRecords;
+        for (uint32_t idx = record.firstChildIdx; idx < record.firstChildIdx + record.numberChildNodes; ++idx) {
+            childRecords[snapshot->get_record(idx).move] = idx;
         }
-        if (pos->is_anti_loss()) {
-            isTerminal = true;
-            value = LOSS;
-            parentNode->checkmateNode = this;
-            return;
+        for (Node* childNode : childNodes) {
+            auto it = childRecords.find(uint32_t(childNode->move));
+            if (it == childRecords.end()) {
+                continue;
+            }
+            const TreeNodeRecord& childRecord = snapshot->get_record(it->second);
+            childNode->probValue = childRecord.probValue;
+            childNode->visits = childRecord.visits;
+            childNode->actionValue = childRecord.actionValue;
+            childNode->qValue = childRecord.qValue;
+            if (childRecord.flags & RECORD_EXPANDED) {
+                childNode->set_snapshot_record(snapshot, it->second);
+                increment_no_visit_idx();
+            }
         }
     }
-#endif
-    if (pos->is_draw(pos->game_ply())) {
-        // reached 50 moves rule
-        value = DRAW;
-        isTerminal = true;
-        return;
+    snapshot = nullptr;
+    if (visits > 0) {
+        sort_child_nodes_by_q_plus_u();
+    }
+    else {
+        sort_child_nodes_by_probabilities();
     }
-    // normal game position
-    //    isTerminal = false;  // is the default value
 }
 
 void Node::make_to_root()
@@ -387,8 +429,15 @@ float Node::compute_q_plus_u() const
 
 void Node::create_child_nodes()
 {
+    // the move flags are computed once during move generation and later used for the policy enhancement
+    const bool setMoveFlags = searchSettings->enhanceChecks || searchSettings->enhanceCaptures;
     for (const ExtMove move : MoveList<LEGAL>(*pos)) {
-        childNodes.push_back(new Node(this, move, searchSettings));
+        Node* childNode = new Node(this, move, searchSettings);
+        if (setMoveFlags) {
+            childNode->isCheckingMove = pos->gives_check(move);
+            childNode->isCaptureMove = pos->capture(move);
+        }
+        childNodes.push_back(childNode);
     }
     numberChildNodes = childNodes.size();
 }
@@ -456,45 +505,57 @@ void create_child_nodes(Node* parentNode, const Board* pos, vector<Node*> &child
     }
 }
 
-bool enhance_move_type(float increment, float thresh, const Board* pos, const vector<Move>& legalMoves, vFunctionMoveType func, DynamicVector<float>& policyProbSmall)
+void set_policy_from_nn_output(const Node* node, const float* data, const vector<uint16_t>& moveLookup, bool applySoftmax,
+                               const SearchSettings* searchSettings, DynamicVector<float>& policyProbSmall)
 {
-    bool update = false;
-    for (size_t i = 0; i < legalMoves.size(); ++i) {
-        if (policyProbSmall[i] < thresh && func(pos, legalMoves[i])) {
-            policyProbSmall[i] += increment;
-            update = true;
-        }
-    }
-    return update;
-}
-
-bool isCheck(const Board* pos, Move move)
-{
-    return pos->gives_check(move);
-}
+    const vector<Node*>& childNodes = node->get_child_nodes();
+    const size_t numberMoves = childNodes.size();
+    policyProbSmall.resize(numberMoves, false);
+    float* probs = policyProbSmall.data();
 
-bool isCapture(const Board* pos, Move move)
-{
-    return pos->capture(move);
-}
+    // gather the entries of all legal moves
+    float maxValue = -std::numeric_limits<float>::infinity();
+    for (size_t i = 0; i < numberMoves; ++i) {
+        probs[i] = data[moveLookup[childNodes[i]->get_move()]];
+        maxValue = std::max(maxValue, probs[i]);
+    }
 
-void enhance_moves(const SearchSettings* searchSettings, const Board* pos, const vector<Move>& legalMoves, DynamicVector<float>& policyProbSmall)
-{
-    float maxPolicyValue = max(policyProbSmall);
-    bool checkUpdate = false;
-    bool captureUpdate = false;
+    if (applySoftmax) {
+        float expSum = 0.0f;
+        for (size_t i = 0; i < numberMoves; ++i) {
+            probs[i] = std::exp(probs[i] - maxValue);
+            expSum += probs[i];
+        }
+        maxValue = 0.0f;
+        for (size_t i = 0; i < numberMoves; ++i) {
+            probs[i] /= expSum;
+            maxValue = std::max(maxValue, probs[i]);
+        }
+    }
 
-    if (searchSettings->enhanceChecks) {
-        checkUpdate = enhance_move_type(min(searchSettings->threshCheck, maxPolicyValue*searchSettings->checkFactor),
-                                        searchSettings->threshCheck, pos, legalMoves, isCheck, policyProbSmall);
+    if (!searchSettings->enhanceChecks && !searchSettings->enhanceCaptures) {
+        return;
     }
-    if (searchSettings->enhanceCaptures) {
-        captureUpdate = enhance_move_type( min(searchSettings->threshCapture, maxPolicyValue*searchSettings->captureFactor),
-                                           searchSettings->threshCheck, pos, legalMoves, isCapture, policyProbSmall);
+    // the increments are zero for disabled enhancements, conditions are evaluated without branches
+    const float checkIncrement = searchSettings->enhanceChecks ? min(searchSettings->threshCheck, maxValue*searchSettings->checkFactor) : 0.0f;
+    const float captureIncrement = searchSettings->enhanceCaptures ? min(searchSettings->threshCapture, maxValue*searchSettings->captureFactor) : 0.0f;
+    const bool enhanceChecks = searchSettings->enhanceChecks;
+    const bool enhanceCaptures = searchSettings->enhanceCaptures;
+    bool update = false;
+    float probSum = 0.0f;
+    for (size_t i = 0; i < numberMoves; ++i) {
+        const bool boostCheck = enhanceChecks & (probs[i] < searchSettings->threshCheck) & childNodes[i]->is_checking_move();
+        probs[i] += boostCheck * checkIncrement;
+        // the capture enhancement uses threshCheck as well, same as the original unfused implementation
+        const bool boostCapture = enhanceCaptures & (probs[i] < searchSettings->threshCheck) & childNodes[i]->is_capture_move();
+        probs[i] += boostCapture * captureIncrement;
+        update |= boostCheck | boostCapture;
+        probSum += probs[i];
     }
-
-    if (checkUpdate || captureUpdate) {
-        policyProbSmall /= sum(policyProbSmall);
+    if (update) {
+        for (size_t i = 0; i < numberMoves; ++i) {
+            probs[i] /= probSum;
+        }
     }
 }
 
@@ -531,18 +592,6 @@ ostream& operator<<(ostream &os, Node *node)
     return os;
 }
 
-void delete_sibling_subtrees(Node* node, unordered_map<Key, Node*>* hashTable)
-{
-    if (node->get_parent_node() != nullptr) {
-        cout << "info string delete unused subtrees" << endl;
-        for (Node* childNode: node->get_parent_node()->get_child_nodes()) {
-            if (childNode != node) {
-                delete_subtree_and_hash_entries(childNode, hashTable);
-            }
-        }
-    }
-}
-
 void delete_subtree_and_hash_entries(Node* node, unordered_map<Key, Node*>* hashTable)
 {
     // if the current node hasn't been expanded or is a terminal node then childNodes is empty and the recursion ends
@@ -630,6 +679,27 @@ float get_current_u_divisor(float numberVisits, float uMin, float uInit, float u
     return uMin - exp(-numberVisits / uBase) * (uMin - uInit);
 }
 
+size_t get_tree_memory(const Node* rootNode)
+{
+    if (rootNode == nullptr) {
+        return 0;
+    }
+    size_t memory = 0;
+    vector<const Node*> openNodes = {rootNode};
+    while (!openNodes.empty()) {
+        const Node* node = openNodes.back();
+        openNodes.pop_back();
+        memory += sizeof(Node) + node->get_child_nodes().capacity() * sizeof(Node*);
+        if (node->is_expanded()) {
+            memory += sizeof(Board) + sizeof(StateInfo);
+        }
+        for (const Node* childNode : node->get_child_nodes()) {
+            openNodes.push_back(childNode);
+        }
+    }
+    return memory;
+}
+
 void print_node_statistics(Node* node)
 {
     size_t candidateIdx = 0;
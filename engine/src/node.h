@@ -37,6 +37,8 @@
 #include "position.h"
 #include "movegen.h"
 #include "board.h"
+#include "constants.h"
+#include "domain/variants.h"
 
 #include "agents/config/searchsettings.h"
 
@@ -44,6 +46,8 @@ using blaze::HybridVector;
 using blaze::DynamicVector;
 using namespace std;
 
+class TreeSnapshot;
+
 class Node
 {
 private:
@@ -71,6 +75,8 @@ private:
     bool isCalibrated;           // determines if the nodes are ordered
     bool areChildNodesSorted;
     bool isFullyExpanded;        // is true if every child node has at least 1 visit
+    bool isCheckingMove;         // the move which led to this node gives check (only set if enhanceChecks or enhanceCaptures is active)
+    bool isCaptureMove;          // the move which led to this node is a capture (only set if enhanceChecks or enhanceCaptures is active)
 
     float uParentFactor;        // stores all parts of the u-value as there a observable by the parent node
     float uDivisorSummand;       // summand which is added to the divisor of the u-divisor
@@ -80,6 +86,15 @@ private:
 
     SearchSettings* searchSettings;
 
+    // record of a loaded tree snapshot from which the node is restored when it gets expanded (nullptr if there isn't any)
+    const TreeSnapshot* snapshot;
+    uint32_t snapshotIdx;
+
+    /**
+     * @brief check_for_terminal Checks if the node is a terminal node and sets its value accordingly.
+     * The variant specific rules are resolved at compile time.
+     */
+    template<Variant variant>
     inline void check_for_terminal();
 
 public:
@@ -114,11 +129,23 @@ public:
      */
     void operator=(const Node& b);
 
+    /**
+     * @brief expand Generates the child nodes for all legal moves and checks if the node is terminal.
+     * This version resolves the variant at runtime and is meant for calls outside of the search loop.
+     */
+    void expand();
+
+    /**
+     * @brief expand Version of expand() for a variant which is known at compile time
+     */
+    template<Variant variant>
     void expand();
     Move get_move() const;
-    vector<Node*> get_child_nodes() const;
+    const vector<Node*>& get_child_nodes() const;
     bool is_terminal() const;
     bool has_nn_results() const;
+    bool is_checking_move() const;
+    bool is_capture_move() const;
     Color side_to_move() const;
     Board* get_pos() const;
     void set_prob_value(float value);
@@ -200,6 +227,24 @@ public:
 
     float get_action_value() const;
     SearchSettings* get_search_settings() const;
+
+    /**
+     * @brief set_snapshot_record Assigns the record of a loaded tree snapshot to the node.
+     * The statistics of the child nodes are restored from it after the next expansion.
+     * @param snapshot Loaded tree snapshot which must outlive the node
+     * @param snapshotIdx Index of the record of this node
+     */
+    void set_snapshot_record(const TreeSnapshot* snapshot, uint32_t snapshotIdx);
+    bool has_snapshot_record() const;
+    const TreeSnapshot* get_snapshot() const;
+    uint32_t get_snapshot_idx() const;
+
+    /**
+     * @brief restore_from_snapshot Sets the value and the statistics of all child nodes from the assigned snapshot record.
+     * Child nodes which have been expanded in the snapshot get their own record assigned and are restored lazily when they are reached.
+     * The node must already be expanded. For a root node the own visits and Q-value are restored as well.
+     */
+    void restore_from_snapshot();
 };
 
 /**
@@ -226,29 +271,20 @@ vector<Move> retrieve_legal_moves(const vector<Node*>& childNodes);
  */
 inline void create_child_nodes(Node* parentNode, const Board* pos, vector<Node*> &childNodes, SearchSettings* searchSettings);
 
-// https://stackoverflow.com/questions/6339970/c-using-function-as-parameter
-typedef bool (* vFunctionMoveType)(const Board* pos, Move move);
-inline bool isCheck(const Board* pos, Move move);
-inline bool isCapture(const Board* pos, Move move);
-
 /**
- * @brief enhance_checks Enhances all possible checking moves below threshCheck by incrementCheck and returns true if a modification
- * was applied. This signals that a renormizalition should be applied afterwards.
- * @param increment_check Constant factor which is added to the checks below threshCheck
- * @param threshCheck Probability threshold for checking moves
- * @return bool
-*/
-inline bool enhance_move_type(float increment, float thresh, const Board* pos, const vector<Move>& legalMoves,
-                              vFunctionMoveType func, DynamicVector<float>& policyProbSmall);
-
-/**
-  * @brief enhance_moves Calls enhance_checks & enchance captures if the searchSetting suggests it and applies a renormilization afterwards
-  * @param threshCheck Threshold probability for checking moves
-  * @param checkFactor Factor based on the maximum probability with which checks will be increased
-  * @param threshCapture Threshold probability for capture moves
-  * @param captureFactor Factor based on the maximum probability with which captures will be increased
+  * @brief set_policy_from_nn_output Fused post-processing of the raw policy output for a single node.
+  * Gathers the entries of the legal moves, applies the softmax if required, boosts checks and captures
+  * based on the move flags of the child nodes and renormalizes in a single sweep over the legal moves.
+  * The result is equivalent to get_probs_of_moves() and apply_softmax() followed by the check and capture enhancement.
+  * @param node Expanded node whose child nodes are in move generation order
+  * @param data Raw policy output of the batch element
+  * @param moveLookup Flat look-up table from move to policy index
+  * @param applySoftmax True, if the raw output are logits
+  * @param searchSettings Settings for the check and capture enhancement
+  * @param policyProbSmall Output vector which is resized to the number of child nodes (its capacity is reused)
   */
-void enhance_moves(const SearchSettings* searchSettings, const Board* pos, const vector<Move>& legalMoves, DynamicVector<float>& policyProbSmall);
+void set_policy_from_nn_output(const Node* node, const float* data, const vector<uint16_t>& moveLookup, bool applySoftmax,
+                               const SearchSettings* searchSettings, DynamicVector<float>& policyProbSmall);
 
 Node* select_child_node(Node* node);
 
@@ -267,12 +303,6 @@ extern std::ostream& operator<<(std::ostream& os, Node* node);
  */
 void delete_subtree_and_hash_entries(Node *node, unordered_map<Key, Node*>* hashTable);
 
-/**
- * @brief delete_sibling_subtrees Deletes all subtrees from all simbling nodes, deletes their hash table entry and sets the visit access to nullptr
- * @param hashTable Pointer to the hashTables
- */
-void delete_sibling_subtrees(Node* node, unordered_map<Key, Node*>* hashTable);
-
 float get_visits(Node* node);
 float get_q_value(Node* node);
 typedef float (* vFunctionValue)(Node* node);
@@ -316,6 +346,14 @@ float get_current_u_divisor(float numberVisits, float uMin, float uInit, float u
  */
 void print_node_statistics(Node* node);
 
+/**
+ * @brief get_tree_memory Estimates the memory of all materialized nodes of the given tree.
+ * It includes the nodes, their child node lists and the positions of the expanded nodes, but not the allocator overhead.
+ * @param rootNode Root node of the tree
+ * @return Memory in bytes
+ */
+size_t get_tree_memory(const Node* rootNode);
+
 /**
  * @brief is_ordering_correct Validates if the ordering of the child nodes is still valid
  * @param childNodes List of nodes, assumed to be ordered based on q+u
@@ -336,4 +374,65 @@ void get_principal_variation(const Node* rootNode, const SearchSettings* searchS
 
 int estimate_visits_to_switch(const float secondScore, const float cpuct, Node* n);
 
+template<Variant variant>
+void Node::expand()
+{
+    create_child_nodes();
+    numberChildNodes = childNodes.size();
+    check_for_terminal<variant>();
+    isExpanded = true;
+    // nodes from a snapshot have already been counted when their parent was restored
+    if (parentNode != nullptr && snapshot == nullptr) {
+        parentNode->increment_no_visit_idx();
+    }
+}
+
+template<Variant variant>
+void Node::check_for_terminal()
+{
+    if (numberChildNodes == 0) {
+        isTerminal = true;
+#ifdef ANTI
+        if (variant == ANTI_VARIANT) {
+            // a stalmate is a win in antichess
+            value = WIN;
+            return;
+        }
+#endif
+        // test if we have a check-mate
+        if (parentNode->pos->gives_check(move)) {
+            value = LOSS;
+            isTerminal = true;
+            parentNode->checkmateNode = this;
+            return;
+        }
+        // we reached a stalmate
+        value = DRAW;
+        return;
+    }
+#ifdef ANTI
+    if (variant == ANTI_VARIANT) {
+        if (pos->is_anti_win()) {
+            isTerminal = true;
+            value = WIN;
+            return;
+        }
+        if (pos->is_anti_loss()) {
+            isTerminal = true;
+            value = LOSS;
+            parentNode->checkmateNode = this;
+            return;
+        }
+    }
+#endif
+    if (pos->is_draw(pos->game_ply())) {
+        // reached 50 moves rule
+        value = DRAW;
+        isTerminal = true;
+        return;
+    }
+    // normal game position
+    //    isTerminal = false;  // is the default value
+}
+
 #endif // NODE_H
@@ -59,12 +59,29 @@ void OptionsUCI::init(OptionsMap &o)
     o["Enhance_Checks"]           << Option(true);
     o["Enhance_Captures"]         << Option(false);
     o["Use_Transposition_Table"]  << Option(true);
+    o["NN_Cache_Size"]            << Option(200000, 0, 100000000);
 #ifdef TENSORRT
     o["Use_TensorRT"]             << Option(false);
 #endif
     o["Model_Directory"]          << Option("model/");
+    o["Model_Watch_Interval"]     << Option(0, 0, 99999);
     o["Move_Overhead"]            << Option(50, 0, 5000);
+    o["Adaptive_Move_Overhead"]   << Option(true);
+    o["Emergency_Time"]           << Option(1000, 0, 99999);
+    o["Emergency_Mode"]           << Option("mcts", {"mcts", "raw"});
+    o["Emergency_Nodes"]          << Option(100, 1, 99999);
+    o["Emergency_Move_Time"]      << Option(100, 1, 5000);
     o["Centi_Random_Move_Factor"] << Option(0, 0, 99);
+#ifdef USE_RL
+    o["Parallel_Games"]           << Option(1, 1, 512);
+    o["Compact_Train_Data"]       << Option(false);
+    o["Shard_Id"]                 << Option("auto");
+    o["Fast_Nodes"]               << Option(0, 0, 99999);
+    o["Centi_Full_Search_Prob"]   << Option(25, 1, 100);
+    o["Centi_Resign_Threshold"]   << Option(0, 0, 100);
+    o["Centi_Resign_Playout"]     << Option(10, 0, 100);
+    o["Metrics_Interval"]         << Option(60, 0, 99999);
+#endif
 }
 
 void OptionsUCI::setoption(istringstream &is)
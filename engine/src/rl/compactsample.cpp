@@ -0,0 +1,95 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: compactsample.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "compactsample.h"
+#include <algorithm>
+
+bool compress_planes(const float* planes, uint64_t* bitboards, int16_t* scalars)
+{
+    bool isLossless = true;
+    for (size_t channel = 0; channel < NB_CHANNELS_TOTAL; ++channel) {
+        const float* channelPlanes = planes + channel * NB_SQUARES;
+        bitboards[channel] = 0;
+        scalars[channel] = int16_t(channelPlanes[0]);
+        if (all_of(channelPlanes, channelPlanes + NB_SQUARES, [&](float value) { return value == channelPlanes[0]; })) {
+            continue;
+        }
+        scalars[channel] = 0;
+        for (size_t square = 0; square < NB_SQUARES; ++square) {
+            if (channelPlanes[square] != 0) {
+                isLossless &= channelPlanes[square] == 1;
+                bitboards[channel] |= uint64_t(1) << square;
+            }
+        }
+    }
+    return isLossless;
+}
+
+void expand_planes(const uint64_t* bitboards, const int16_t* scalars, int16_t* planes)
+{
+    for (size_t channel = 0; channel < NB_CHANNELS_TOTAL; ++channel) {
+        int16_t* channelPlanes = planes + channel * NB_SQUARES;
+        if (bitboards[channel] == 0) {
+            fill(channelPlanes, channelPlanes + NB_SQUARES, scalars[channel]);
+            continue;
+        }
+        for (size_t square = 0; square < NB_SQUARES; ++square) {
+            channelPlanes[square] = (bitboards[channel] >> square) & 1;
+        }
+    }
+}
+
+size_t get_policy_index(Move move, Color sideToMove)
+{
+    if (sideToMove == WHITE) {
+        return MV_LOOKUP_CLASSIC[move];
+    }
+    return MV_LOOKUP_MIRRORED_CLASSIC[move];
+}
+
+size_t compress_policy(const vector<Move>& legalMoves, const DynamicVector<float>& policyProbSmall, Color sideToMove,
+                       vector<int16_t>& indices, vector<float>& probs)
+{
+    assert(legalMoves.size() == policyProbSmall.size());
+
+    size_t numberEntries = 0;
+    for (size_t idx = 0; idx < legalMoves.size(); ++idx) {
+        if (policyProbSmall[idx] != 0) {
+            indices.push_back(int16_t(get_policy_index(legalMoves[idx], sideToMove)));
+            probs.push_back(policyProbSmall[idx]);
+            ++numberEntries;
+        }
+    }
+    return numberEntries;
+}
+
+void expand_policy(const int16_t* indices, const float* probs, size_t numberEntries, float* policy)
+{
+    fill(policy, policy + NB_LABELS, 0.0f);
+    for (size_t idx = 0; idx < numberEntries; ++idx) {
+        policy[indices[idx]] = probs[idx];
+    }
+}
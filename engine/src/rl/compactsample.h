@@ -0,0 +1,90 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: compactsample.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Compact encoding of training samples.
+ * Every binary input plane is packed into a 64 bit board and every constant plane is reduced to a single scalar.
+ * The policy target only keeps the (index, probability) entries of the legal moves.
+ * The expand functions restore the dense tensors which are used by the training pipeline.
+ */
+
+#ifndef COMPACTSAMPLE_H
+#define COMPACTSAMPLE_H
+
+#include <vector>
+#include "types.h"
+#include "../domain/crazyhouse/constants.h"
+#include "../util/blazeutil.h"
+
+using namespace std;
+
+/**
+ * @brief compress_planes Encodes the plane representation of a single board position.
+ * A channel is stored as a scalar if all its values are equal and as a bitboard if it only consists of zeros and ones.
+ * Channels with a bitboard unequal to zero are binary channels, all others are constant channels which hold their value in the scalar.
+ * @param planes NB_VALUES_TOTAL unnormalized plane values
+ * @param bitboards Output with NB_CHANNELS_TOTAL entries
+ * @param scalars Output with NB_CHANNELS_TOTAL entries
+ * @return False, if a channel is neither binary nor constant and the encoding is lossy
+ */
+bool compress_planes(const float* planes, uint64_t* bitboards, int16_t* scalars);
+
+/**
+ * @brief expand_planes Restores the plane representation of compress_planes()
+ * @param bitboards NB_CHANNELS_TOTAL bitboards
+ * @param scalars NB_CHANNELS_TOTAL scalars
+ * @param planes Output with NB_VALUES_TOTAL entries
+ */
+void expand_planes(const uint64_t* bitboards, const int16_t* scalars, int16_t* planes);
+
+/**
+ * @brief get_policy_index Returns the index of a move in the policy target vector
+ * @param move Legal move
+ * @param sideToMove Current side to move
+ * @return Index in [0, NB_LABELS)
+ */
+size_t get_policy_index(Move move, Color sideToMove);
+
+/**
+ * @brief compress_policy Appends the entries of all moves with a non-zero probability
+ * @param legalMoves List of legal moves
+ * @param policyProbSmall Probability for each move
+ * @param sideToMove Current side to move
+ * @param indices Policy indices of the entries
+ * @param probs Probabilities of the entries
+ * @return Number of appended entries
+ */
+size_t compress_policy(const vector<Move>& legalMoves, const DynamicVector<float>& policyProbSmall, Color sideToMove,
+                       vector<int16_t>& indices, vector<float>& probs);
+
+/**
+ * @brief expand_policy Restores the dense policy target of compress_policy()
+ * @param indices Policy indices of the entries
+ * @param probs Probabilities of the entries
+ * @param numberEntries Number of entries of the sample
+ * @param policy Output with NB_LABELS entries
+ */
+void expand_policy(const int16_t* indices, const float* probs, size_t numberEntries, float* policy);
+
+#endif // COMPACTSAMPLE_H
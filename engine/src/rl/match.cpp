@@ -0,0 +1,228 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: match.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "match.h"
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <deque>
+#include "thread.h"
+#include "uci.h"
+#include "movegen.h"
+#include "../node.h"
+#include "../domain/variants.h"
+
+size_t MatchResult::number_games() const
+{
+    return wins + draws + losses;
+}
+
+float MatchResult::score() const
+{
+    return (wins + 0.5f * draws) / number_games();
+}
+
+float score_to_elo(float score)
+{
+    return -400.0f * log10(1.0f / score - 1.0f);
+}
+
+void compute_elo(const MatchResult& result, float& elo, float& eloError)
+{
+    const float minScore = 0.001f;
+    const size_t numberGames = result.number_games();
+    const float score = result.score();
+    // standard error of the mean score of a single game
+    const float variance = (result.wins * pow(1.0f - score, 2) + result.draws * pow(0.5f - score, 2) + result.losses * pow(score, 2)) / numberGames;
+    const float scoreError = 1.96f * sqrt(variance / numberGames);
+    // the Elo difference is unbounded for a score of 0 or 1
+    elo = score_to_elo(clamp(score, minScore, 1.0f - minScore));
+    const float eloLow = score_to_elo(clamp(score - scoreError, minScore, 1.0f - minScore));
+    const float eloHigh = score_to_elo(clamp(score + scoreError, minScore, 1.0f - minScore));
+    eloError = (eloHigh - eloLow) / 2;
+}
+
+vector<string> load_openings(const string& fileName)
+{
+    vector<string> openings;
+    ifstream openingFile(fileName);
+    string line;
+    while (getline(openingFile, line)) {
+        istringstream is(line);
+        vector<string> fields;
+        string field;
+        while (is >> field) {
+            fields.push_back(field);
+        }
+        if (fields.size() < 4) {
+            continue;
+        }
+        string fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+        // EPD operations follow the first four fields instead of the move counters
+        const bool hasMoveCounters = fields.size() >= 6 && isdigit(fields[4][0]) && isdigit(fields[5][0]);
+        fen += hasMoveCounters ? " " + fields[4] + " " + fields[5] : " 0 1";
+        openings.push_back(fen);
+    }
+    return openings;
+}
+
+bool is_terminal_position(const Board& pos, float& value)
+{
+    // same rules as Node::check_for_terminal() without allocating a node and its child nodes
+    if (MoveList<LEGAL>(pos).size() == 0) {
+#ifdef ANTI
+        if (pos.variant() == ANTI_VARIANT) {
+            // a stalemate is a win in antichess
+            value = WIN;
+            return true;
+        }
+#endif
+        value = pos.checkers() ? LOSS : DRAW;
+        return true;
+    }
+#ifdef ANTI
+    if (pos.variant() == ANTI_VARIANT) {
+        if (pos.is_anti_win()) {
+            value = WIN;
+            return true;
+        }
+        if (pos.is_anti_loss()) {
+            value = LOSS;
+            return true;
+        }
+    }
+#endif
+    if (pos.is_draw(pos.game_ply())) {
+        value = DRAW;
+        return true;
+    }
+    return false;
+}
+
+Match::Match(const vector<MCTSAgent*>& agentsA, const vector<MCTSAgent*>& agentsB, const vector<string>& openings, Variant variant):
+    agentsA(agentsA),
+    agentsB(agentsB),
+    openings(openings),
+    variant(variant),
+    numberGames(0),
+    nextGameIdx(0)
+{
+    if (this->openings.empty()) {
+        this->openings.push_back(StartFENs[variant]);
+    }
+}
+
+bool Match::acquire_game(size_t& gameIdx)
+{
+    lock_guard<mutex> lock(mtx);
+    if (nextGameIdx == numberGames) {
+        return false;
+    }
+    gameIdx = nextGameIdx++;
+    return true;
+}
+
+int Match::play_game(MCTSAgent* agentA, MCTSAgent* agentB, size_t gameIdx, const SearchLimits& searchLimits)
+{
+    const string& fen = openings[(gameIdx / 2) % openings.size()];
+    const bool isWhiteA = gameIdx % 2 == 0;
+
+    auto uiThread = make_shared<Thread>(0);
+    deque<StateInfo> states(1);
+    Board pos;
+    pos.set(fen, false, variant, &states.back(), uiThread.get());
+
+    EvalInfo evalInfo;
+    int whiteResult = DRAW;
+    for (size_t ply = 0; ply < MATCH_MAX_PLIES; ++ply) {
+        float value;
+        if (is_terminal_position(pos, value)) {
+            whiteResult = pos.side_to_move() == WHITE ? int(value) : -int(value);
+            break;
+        }
+        const bool isTurnA = (pos.side_to_move() == WHITE) == isWhiteA;
+        MCTSAgent* player = isTurnA ? agentA : agentB;
+        MCTSAgent* opponent = isTurnA ? agentB : agentA;
+
+        SearchLimits moveLimits(searchLimits);
+        moveLimits.startTime = now();
+        player->perform_action(&pos, &moveLimits, evalInfo);
+        player->apply_move_to_tree(evalInfo.bestMove, true);
+        opponent->apply_move_to_tree(evalInfo.bestMove, false);
+        states.emplace_back();
+        pos.do_move(evalInfo.bestMove, states.back());
+    }
+    // the trees reference the states of this game
+    agentA->clear_game_history();
+    agentB->clear_game_history();
+    // the state infos are owned by the deque
+    pos.setStateInfo(nullptr);
+    return isWhiteA ? whiteResult : -whiteResult;
+}
+
+void Match::add_result(int gameResult)
+{
+    lock_guard<mutex> lock(mtx);
+    if (gameResult == WIN) {
+        ++result.wins;
+    }
+    else if (gameResult == DRAW) {
+        ++result.draws;
+    }
+    else {
+        ++result.losses;
+    }
+    float elo;
+    float eloError;
+    compute_elo(result, elo, eloError);
+    cout << "info string match games " << result.number_games() << " W " << result.wins << " D " << result.draws << " L " << result.losses
+         << " elo " << elo << " +/- " << eloError << endl;
+}
+
+void Match::play_games(size_t workerIdx, SearchLimits searchLimits)
+{
+    size_t gameIdx;
+    while (acquire_game(gameIdx)) {
+        add_result(play_game(agentsA[workerIdx], agentsB[workerIdx], gameIdx, searchLimits));
+    }
+}
+
+MatchResult Match::go(size_t numberGames, const SearchLimits& searchLimits)
+{
+    this->numberGames = numberGames;
+    nextGameIdx = 0;
+    result = MatchResult();
+    vector<thread> workers;
+    for (size_t workerIdx = 0; workerIdx < agentsA.size(); ++workerIdx) {
+        workers.emplace_back(&Match::play_games, this, workerIdx, searchLimits);
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+    return result;
+}
@@ -0,0 +1,150 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: match.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Engine-vs-engine match between two networks which runs within a single process.
+ * Every concurrent game has its own agent for each network, while all agents of the same network evaluate their
+ * positions together in one shared batch.
+ */
+
+#ifndef MATCH_H
+#define MATCH_H
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include "../agents/mctsagent.h"
+#include "../agents/config/searchlimits.h"
+
+// games which reach this number of plies are adjudicated as a draw
+const size_t MATCH_MAX_PLIES = 1000;
+
+/**
+ * @brief The MatchResult struct holds the number of wins, draws and losses from the perspective of the first network
+ */
+struct MatchResult
+{
+    size_t wins = 0;
+    size_t draws = 0;
+    size_t losses = 0;
+
+    size_t number_games() const;
+    float score() const;
+};
+
+/**
+ * @brief score_to_elo Converts an expected score into an Elo difference
+ * @param score Score in (0, 1)
+ * @return Elo difference
+ */
+float score_to_elo(float score);
+
+/**
+ * @brief compute_elo Estimates the Elo difference of a match result and its 95% confidence interval
+ * @param result Match result
+ * @param elo Estimated Elo difference
+ * @param eloError Half width of the confidence interval
+ */
+void compute_elo(const MatchResult& result, float& elo, float& eloError);
+
+/**
+ * @brief load_openings Reads the starting positions of a FEN or EPD file with one position per line.
+ * EPD positions which don't contain the move counters are completed with "0 1".
+ * @param fileName Opening file
+ * @return List of FENs
+ */
+vector<string> load_openings(const string& fileName);
+
+/**
+ * @brief is_terminal_position Checks if the game has ended in the given position
+ * @param pos Board position
+ * @param value Value of the terminal position from the perspective of the side to move
+ * @return True, if the position is terminal
+ */
+bool is_terminal_position(const Board& pos, float& value);
+
+class Match
+{
+private:
+    // agents of the first and second network, the agents with the same index play the same game
+    vector<MCTSAgent*> agentsA;
+    vector<MCTSAgent*> agentsB;
+    vector<string> openings;
+    Variant variant;
+
+    size_t numberGames;
+    size_t nextGameIdx;
+    MatchResult result;
+    mutex mtx;
+
+    /**
+     * @brief acquire_game Reserves the next game
+     * @param gameIdx Index of the reserved game
+     * @return True, if there was a game left to play
+     */
+    bool acquire_game(size_t& gameIdx);
+
+    /**
+     * @brief play_game Plays a single game. Every opening is played twice with swapped colors.
+     * @param agentA Agent of the first network
+     * @param agentB Agent of the second network
+     * @param gameIdx Index of the game
+     * @param searchLimits Search limits for every move
+     * @return Game result from the perspective of the first network: LOSS, DRAW, WIN
+     */
+    int play_game(MCTSAgent* agentA, MCTSAgent* agentB, size_t gameIdx, const SearchLimits& searchLimits);
+
+    /**
+     * @brief play_games Worker loop which plays games until all games have been started
+     * @param workerIdx Index of the agents of the worker
+     * @param searchLimits Search limits for every move
+     */
+    void play_games(size_t workerIdx, SearchLimits searchLimits);
+
+    /**
+     * @brief add_result Adds the result of a finished game and prints the current standing
+     * @param gameResult Game result from the perspective of the first network
+     */
+    void add_result(int gameResult);
+
+public:
+    /**
+     * @brief Match
+     * @param agentsA Agents of the first network, one for each concurrent game
+     * @param agentsB Agents of the second network, one for each concurrent game
+     * @param openings Starting positions which are played in turn
+     * @param variant Chess variant
+     */
+    Match(const vector<MCTSAgent*>& agentsA, const vector<MCTSAgent*>& agentsB, const vector<string>& openings, Variant variant);
+
+    /**
+     * @brief go Plays the given number of games with as many concurrent games as there are agents per network
+     * @param numberGames Number of games
+     * @param searchLimits Fixed nodes or movetime for every move
+     * @return Result from the perspective of the first network
+     */
+    MatchResult go(size_t numberGames, const SearchLimits& searchLimits);
+};
+
+#endif // MATCH_H
@@ -0,0 +1,53 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: rlsettings.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Settings which only affect the game generation in self play mode
+ */
+
+#ifndef RLSETTINGS_H
+#define RLSETTINGS_H
+
+#include <cstddef>
+
+struct RLSettings
+{
+public:
+    // node limit of the cheap searches which aren't exported, 0 disables playout cap randomization
+    size_t fastNodes;
+    // probability for a move to be searched with the full node limit and to be exported
+    float fullSearchProb;
+    // a side resigns if the Q-value of its best move falls below -resignThreshold, 0 disables resignation
+    float resignThreshold;
+    // probability for a game to be played out despite a resignation in order to measure the false positive rate
+    float resignPlayoutProb;
+
+    RLSettings():
+        fastNodes(0),
+        fullSearchProb(1.0f),
+        resignThreshold(0.0f),
+        resignPlayoutProb(0.1f) {}
+};
+
+#endif // RLSETTINGS_H
@@ -30,10 +30,25 @@
 #include "thread.h"
 #include <iostream>
 #include <fstream>
+#include <random>
+#include <algorithm>
 #include "../domain/variants.h"
 
-SelfPlay::SelfPlay(MCTSAgent* mctsAgent):
-    mctsAgent(mctsAgent)
+SelfPlay::SelfPlay(const vector<MCTSAgent*>& mctsAgents, const RLSettings& rlSettings, const string& shardId, bool isCompactTrainData, double metricsInterval):
+    mctsAgents(mctsAgents),
+    rlSettings(rlSettings),
+    exporter(shardId, isCompactTrainData),
+    pgnFileName("games_" + shardId + ".pgn"),
+    remainingGames(0),
+    resignPlayouts(0),
+    falseResigns(0),
+    metrics("metrics_" + shardId + ".jsonl", metricsInterval),
+    evaluatedNodesPreGo(0),
+    batchCapacityPreGo(0)
+{
+}
+
+void SelfPlay::init_game_pgn(GamePGN& gamePGN)
 {
     gamePGN.variant = "crazyhouse";
     gamePGN.event = "CrazyAra-SelfPlay";
@@ -45,20 +60,62 @@ SelfPlay::SelfPlay(MCTSAgent* mctsAgent):
     gamePGN.is960 = false;
 }
 
-void SelfPlay::generate_game(Variant variant, SearchLimits& searchLimits)
+/**
+ * @brief random_probability Returns a uniformly distributed random number in [0, 1) from a generator of the calling thread
+ */
+float random_probability()
+{
+    static thread_local mt19937 generator(random_device{}());
+    return uniform_real_distribution<float>(0.0f, 1.0f)(generator);
+}
+
+void SelfPlay::generate_game(MCTSAgent* mctsAgent, Variant variant, SearchLimits& searchLimits)
 {
     Board* position = new Board();
-    string token, cmd;
     auto uiThread = make_shared<Thread>(0);
+    GamePGN gamePGN;
+    init_game_pgn(gamePGN);
 
     StateInfo* newState = new StateInfo;
     position->set(StartFENs[variant], false, variant, newState, uiThread.get());
     EvalInfo evalInfo;
+    // the search results are kept until the game result is known
+    vector<EvalInfo> evalInfos;
+    vector<bool> exportMask;
+    GameStatistics statistics;
+    size_t evaluatedNodesPreGame;
+    size_t batchCapacityPreGame;
+    mctsAgent->get_nn_statistics(evaluatedNodesPreGame, batchCapacityPreGame);
+
+    const size_t fullNodes = searchLimits.nodes;
+    const bool isResignAllowed = rlSettings.resignThreshold > 0 && random_probability() >= rlSettings.resignPlayoutProb;
+    // result which a resignation would have caused in a game which is played out
+    int16_t resignResult = DRAW;
+    bool isResignRecorded = false;
+    bool isResigned = false;
 
     bool isTerminal = false;
     do {
+        const bool isFullSearch = rlSettings.fastNodes == 0 || random_probability() < rlSettings.fullSearchProb;
+        searchLimits.nodes = isFullSearch ? fullNodes : rlSettings.fastNodes;
         searchLimits.startTime = now();
+        const auto searchStart = chrono::steady_clock::now();
         mctsAgent->perform_action(position, &searchLimits, evalInfo);
+        statistics.searchTime += elapsed_seconds(searchStart);
+        statistics.nodes += evalInfo.nodes;
+
+        if (rlSettings.resignThreshold > 0 && !isResignRecorded && evalInfo.bestMoveQ < -rlSettings.resignThreshold) {
+            // the side to move gives up
+            resignResult = position->side_to_move() == WHITE ? LOSS : WIN;
+            isResignRecorded = true;
+            if (isResignAllowed) {
+                isResigned = true;
+                break;
+            }
+        }
+
+        evalInfos.push_back(evalInfo);
+        exportMask.push_back(isFullSearch);
         mctsAgent->apply_move_to_tree(evalInfo.bestMove, true);
         const Node* nextRoot = mctsAgent->get_opponents_next_root();
         if (nextRoot != nullptr) {
@@ -71,30 +128,80 @@ void SelfPlay::generate_game(Variant variant, SearchLimits& searchLimits)
                                             isTerminal));
     }
     while(!isTerminal);
+    searchLimits.nodes = fullNodes;
 
-    cout << "info string terminal fen " << mctsAgent->get_opponents_next_root()->get_pos()->fen() << " move " << UCI::move(evalInfo.bestMove, evalInfo.isChess960)<< endl;
-    mctsAgent->export_game_results();
-    set_game_result_to_pgn();
-    write_game_to_pgn();
-    gamePGN.new_game();
+    int16_t result;
+    if (isResigned) {
+        result = resignResult;
+        cout << "info string resign fen " << position->fen() << endl;
+    }
+    else {
+        const Node* terminalNode = mctsAgent->get_opponents_next_root();
+        cout << "info string terminal fen " << terminalNode->get_pos()->fen() << " move " << UCI::move(evalInfo.bestMove, evalInfo.isChess960)<< endl;
+        result = get_game_result(terminalNode);
+        if (isResignRecorded) {
+            update_resign_statistics(resignResult, result);
+        }
+    }
+    const auto exportStart = chrono::steady_clock::now();
+    exporter.export_game(StartFENs[variant], variant, evalInfos, exportMask, result);
+    statistics.exportTime = elapsed_seconds(exportStart);
+    const auto pgnStart = chrono::steady_clock::now();
+    set_game_result_to_pgn(result, gamePGN);
+    write_game_to_pgn(gamePGN);
+    statistics.pgnTime = elapsed_seconds(pgnStart);
     mctsAgent->clear_game_history();
+
+    statistics.plies = evalInfos.size();
+    statistics.samples = count(exportMask.begin(), exportMask.end(), true);
+    size_t evaluatedNodes;
+    size_t batchCapacity;
+    mctsAgent->get_nn_statistics(evaluatedNodes, batchCapacity);
+    if (mctsAgent->uses_shared_net_batch()) {
+        // the batches are shared with the parallel games, so the batch fill is only known for all games together
+        metrics.set_nn_statistics(evaluatedNodes - evaluatedNodesPreGo, batchCapacity - batchCapacityPreGo);
+    }
+    else {
+        statistics.evaluatedNodes = evaluatedNodes - evaluatedNodesPreGame;
+        statistics.batchCapacity = batchCapacity - batchCapacityPreGame;
+    }
+    metrics.add_game(statistics);
 }
 
-void SelfPlay::write_game_to_pgn()
+void SelfPlay::update_resign_statistics(int16_t resignResult, int16_t result)
 {
+    lock_guard<mutex> lock(resignMtx);
+    ++resignPlayouts;
+    // a resignation was wrong if the resigning side drew or won the game
+    if (result != resignResult) {
+        ++falseResigns;
+    }
+    cout << "info string resign false positives " << falseResigns << " of " << resignPlayouts << " played out games" << endl;
+}
+
+void SelfPlay::write_game_to_pgn(const GamePGN& gamePGN)
+{
+    lock_guard<mutex> lock(pgnMtx);
     ofstream pgnFile;
-    pgnFile.open("games.pgn", std::ios_base::app);  // TODO: Change to more meaningful filename
+    pgnFile.open(pgnFileName, std::ios_base::app);
     cout << endl << gamePGN << endl;
     pgnFile << gamePGN << endl;
     pgnFile.close();
 }
 
-void SelfPlay::set_game_result_to_pgn()
+int16_t SelfPlay::get_game_result(const Node* terminalNode) const
+{
+    // the value of a terminal node is given from the perspective of its side to move
+    const int16_t value = int16_t(terminalNode->get_value());
+    return terminalNode->get_pos()->side_to_move() == WHITE ? value : -value;
+}
+
+void SelfPlay::set_game_result_to_pgn(int16_t result, GamePGN& gamePGN)
 {
-    if (int(mctsAgent->get_opponents_next_root()->get_value()) == 0) {
+    if (result == DRAW) {
         gamePGN.result = "1/2-1/2";
     }
-    else if ( mctsAgent->get_opponents_next_root()->get_pos()->side_to_move() == BLACK) {
+    else if (result == WIN) {
         gamePGN.result = "1-0";
     }
     else {
@@ -102,10 +209,41 @@ void SelfPlay::set_game_result_to_pgn()
     }
 }
 
+bool SelfPlay::acquire_game()
+{
+    lock_guard<mutex> lock(remainingGamesMtx);
+    if (remainingGames == 0) {
+        return false;
+    }
+    --remainingGames;
+    return true;
+}
+
+void SelfPlay::play_games(MCTSAgent* mctsAgent, SearchLimits searchLimits)
+{
+    while (acquire_game()) {
+        generate_game(mctsAgent, CRAZYHOUSE_VARIANT, searchLimits);
+    }
+}
+
 void SelfPlay::go(size_t numberOfGames, SearchLimits& searchLimits)
 {
-    for (size_t idx = 0; idx < numberOfGames; ++idx) {
-        generate_game(CRAZYHOUSE_VARIANT, searchLimits);
+    remainingGames = numberOfGames;
+    mctsAgents.front()->get_nn_statistics(evaluatedNodesPreGo, batchCapacityPreGo);
+    if (mctsAgents.size() == 1) {
+        play_games(mctsAgents.front(), searchLimits);
+    }
+    else {
+        vector<thread> workers;
+        for (MCTSAgent* mctsAgent : mctsAgents) {
+            workers.emplace_back(&SelfPlay::play_games, this, mctsAgent, searchLimits);
+        }
+        for (thread& worker : workers) {
+            worker.join();
+        }
     }
+    // the last games don't necessarily fill a chunk
+    exporter.flush();
+    metrics.report_final();
 }
 #endif
@@ -31,34 +31,98 @@
 #include "../agents/mctsagent.h"
 #include "gamepgn.h"
 #include "../manager/statesmanager.h"
+#include "traindataexporter.h"
+#include "rlsettings.h"
+#include "selfplaymetrics.h"
 
 #ifdef USE_RL
 class SelfPlay
 {
 private:
-    MCTSAgent* mctsAgent;
-    GamePGN gamePGN;
-    EvalInfo evalInfo;
+    // one agent for every game which is played in parallel
+    vector<MCTSAgent*> mctsAgents;
+    RLSettings rlSettings;
+    TrainDataExporter exporter;
+    string pgnFileName;
+    mutex pgnMtx;
+    // number of games which haven't been started yet
+    size_t remainingGames;
+    mutex remainingGamesMtx;
+    // number of games which were played out after a resignation and how many of them the resigning side didn't lose
+    size_t resignPlayouts;
+    size_t falseResigns;
+    mutex resignMtx;
+    SelfPlayMetrics metrics;
+    // network statistics of the shared network at the start of go()
+    size_t evaluatedNodesPreGo;
+    size_t batchCapacityPreGo;
 
     /**
-     * @brief generate_game Generates a new game in self play mode
+     * @brief init_game_pgn Sets the meta information of a new pgn game
+     * @param gamePGN Game which will be initialized
+     */
+    void init_game_pgn(GamePGN& gamePGN);
+
+    /**
+     * @brief generate_game Generates a new game in self play mode.
+     * With playout cap randomization only the positions of the full searches are exported.
+     * @param mctsAgent Agent which plays both sides of the game
      * @param variant Current chess variant
      * @param searchLimits Search limits struct
      */
-    void generate_game(Variant variant, SearchLimits& searchLimits);
+    void generate_game(MCTSAgent* mctsAgent, Variant variant, SearchLimits& searchLimits);
 
     /**
      * @brief write_game_to_pgn Writes the game log to a pgn file
+     * @param gamePGN Finished game
+     */
+    void write_game_to_pgn(const GamePGN& gamePGN);
+
+    /**
+     * @brief get_game_result Returns the result of the finished game from the perspective of the first side to move
+     * @param terminalNode Terminal node of the game
+     * @return LOSS, DRAW or WIN
+     */
+    int16_t get_game_result(const Node* terminalNode) const;
+
+    /**
+     * @brief update_resign_statistics Records the outcome of a game which was played out after a resignation
+     * @param resignResult Game result which the resignation would have caused
+     * @param result Actual game result
      */
-    void write_game_to_pgn();
+    void update_resign_statistics(int16_t resignResult, int16_t result);
 
     /**
-     * @brief set_game_result Sets the game result to the gamePGN object
+     * @brief set_game_result_to_pgn Sets the game result to the gamePGN object
+     * @param result Game result from the perspective of white
+     * @param gamePGN Finished game
      */
-    void set_game_result_to_pgn();
+    void set_game_result_to_pgn(int16_t result, GamePGN& gamePGN);
+
+    /**
+     * @brief acquire_game Reserves one of the remaining games
+     * @return True, if there was a game left to play
+     */
+    bool acquire_game();
+
+    /**
+     * @brief play_games Worker loop of a single agent which generates games until the requested number of games is reached
+     * @param mctsAgent Agent of the worker
+     * @param searchLimits Search limits of the worker
+     */
+    void play_games(MCTSAgent* mctsAgent, SearchLimits searchLimits);
 
 public:
-    SelfPlay(MCTSAgent* mctsAgent);
+    /**
+     * @brief SelfPlay
+     * @param mctsAgents Agents of which each plays a separate game at the same time. The agents usually share a
+     * batched network, so that the positions of all games are evaluated together.
+     * @param rlSettings Settings for playout cap randomization and resignation
+     * @param shardId Id which separates the training data and games of this process from the ones of other processes
+     * @param isCompactTrainData True, if the training data shall be exported in the compact layout
+     * @param metricsInterval Minimum time between two metric reports in seconds
+     */
+    SelfPlay(const vector<MCTSAgent*>& mctsAgents, const RLSettings& rlSettings, const string& shardId, bool isCompactTrainData, double metricsInterval);
 
     /**
      * @brief go Starts the self play game generation for a given number of games
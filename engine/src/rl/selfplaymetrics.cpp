@@ -0,0 +1,119 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: selfplaymetrics.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "selfplaymetrics.h"
+
+#ifdef USE_RL
+#include <iostream>
+#include <fstream>
+#include "nlohmann/json.hpp"
+
+double elapsed_seconds(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief safe_ratio Returns numerator / denominator or 0 if the denominator is 0
+ */
+double safe_ratio(double numerator, double denominator)
+{
+    return denominator > 0 ? numerator / denominator : 0;
+}
+
+SelfPlayMetrics::SelfPlayMetrics(const string& metricsFileName, double reportInterval):
+    metricsFileName(metricsFileName),
+    reportInterval(reportInterval),
+    startTime(chrono::steady_clock::now()),
+    lastReportTime(startTime),
+    numberGames(0)
+{
+}
+
+void SelfPlayMetrics::add_game(const GameStatistics& game)
+{
+    lock_guard<mutex> lock(mtx);
+    ++numberGames;
+    total.plies += game.plies;
+    total.samples += game.samples;
+    total.nodes += game.nodes;
+    total.evaluatedNodes += game.evaluatedNodes;
+    total.batchCapacity += game.batchCapacity;
+    total.searchTime += game.searchTime;
+    total.exportTime += game.exportTime;
+    total.pgnTime += game.pgnTime;
+    if (elapsed_seconds(lastReportTime) >= reportInterval) {
+        report();
+    }
+}
+
+void SelfPlayMetrics::set_nn_statistics(size_t evaluatedNodes, size_t batchCapacity)
+{
+    lock_guard<mutex> lock(mtx);
+    total.evaluatedNodes = evaluatedNodes;
+    total.batchCapacity = batchCapacity;
+}
+
+void SelfPlayMetrics::report_final()
+{
+    lock_guard<mutex> lock(mtx);
+    report();
+}
+
+void SelfPlayMetrics::report()
+{
+    lastReportTime = chrono::steady_clock::now();
+    const double elapsedTime = elapsed_seconds(startTime);
+    // the times of parallel games add up, so the split is given relative to their sum
+    const double measuredTime = total.searchTime + total.exportTime + total.pgnTime;
+
+    nlohmann::json metrics;
+    metrics["elapsed_s"] = elapsedTime;
+    metrics["games"] = numberGames;
+    metrics["samples"] = total.samples;
+    metrics["games_per_hour"] = safe_ratio(numberGames * 3600.0, elapsedTime);
+    metrics["samples_per_s"] = safe_ratio(total.samples, elapsedTime);
+    metrics["avg_plies"] = safe_ratio(total.plies, numberGames);
+    metrics["avg_nodes_per_move"] = safe_ratio(total.nodes, total.plies);
+    metrics["batch_fill_ratio"] = safe_ratio(total.evaluatedNodes, total.batchCapacity);
+    metrics["search_time_ratio"] = safe_ratio(total.searchTime, measuredTime);
+    metrics["export_time_ratio"] = safe_ratio(total.exportTime, measuredTime);
+    metrics["pgn_time_ratio"] = safe_ratio(total.pgnTime, measuredTime);
+
+    cout << "info string selfplay games " << numberGames
+         << " games/h " << metrics["games_per_hour"].get<double>()
+         << " samples/s " << metrics["samples_per_s"].get<double>()
+         << " plies " << metrics["avg_plies"].get<double>()
+         << " nodes/move " << metrics["avg_nodes_per_move"].get<double>()
+         << " batchfill " << metrics["batch_fill_ratio"].get<double>()
+         << " search " << metrics["search_time_ratio"].get<double>()
+         << " export " << metrics["export_time_ratio"].get<double>()
+         << " pgn " << metrics["pgn_time_ratio"].get<double>() << endl;
+
+    ofstream metricsFile(metricsFileName, ios_base::app);
+    metricsFile << metrics.dump() << endl;
+}
+#endif
@@ -0,0 +1,112 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: selfplaymetrics.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Throughput statistics of the self play game generation which are reported periodically to stdout
+ * and as JSON lines to a metrics file.
+ */
+
+#ifndef SELFPLAYMETRICS_H
+#define SELFPLAYMETRICS_H
+
+#include <string>
+#include <mutex>
+#include <chrono>
+
+using namespace std;
+
+#ifdef USE_RL
+/**
+ * @brief The GameStatistics struct holds the measurements of a single self play game
+ */
+struct GameStatistics
+{
+    size_t plies = 0;
+    // number of exported training samples
+    size_t samples = 0;
+    // sum of the nodes of all searches
+    size_t nodes = 0;
+    // positions which were evaluated by the neural network and the positions which the evaluated mini-batches could have held,
+    // they stay 0 for games which share the network with other games
+    size_t evaluatedNodes = 0;
+    size_t batchCapacity = 0;
+    // time spent for the searches, for encoding and queuing the training samples and for writing the pgn in seconds
+    double searchTime = 0;
+    double exportTime = 0;
+    double pgnTime = 0;
+};
+
+class SelfPlayMetrics
+{
+private:
+    mutex mtx;
+    string metricsFileName;
+    // minimum time between two reports in seconds
+    double reportInterval;
+    chrono::steady_clock::time_point startTime;
+    chrono::steady_clock::time_point lastReportTime;
+    // accumulated statistics of all games since the start
+    GameStatistics total;
+    size_t numberGames;
+
+    /**
+     * @brief report Prints the current metrics and appends them to the metrics file. It must be called while holding the lock.
+     */
+    void report();
+
+public:
+    /**
+     * @brief SelfPlayMetrics
+     * @param metricsFileName File to which every report is appended as a single JSON line
+     * @param reportInterval Minimum time between two reports in seconds
+     */
+    SelfPlayMetrics(const string& metricsFileName, double reportInterval);
+
+    /**
+     * @brief add_game Adds the statistics of a finished game and reports the metrics if the report interval has passed
+     * @param game Statistics of the game
+     */
+    void add_game(const GameStatistics& game);
+
+    /**
+     * @brief set_nn_statistics Replaces the accumulated network statistics of the games by the given totals.
+     * It is used for games which share the batches of one network, because their batches can't be attributed to a single game.
+     * @param evaluatedNodes Number of evaluated positions since the start
+     * @param batchCapacity Number of positions which the evaluated batches could have held since the start
+     */
+    void set_nn_statistics(size_t evaluatedNodes, size_t batchCapacity);
+
+    /**
+     * @brief report_final Reports the metrics independent of the report interval, e.g. after the last game
+     */
+    void report_final();
+};
+
+/**
+ * @brief elapsed_seconds Returns the time in seconds which has passed since the given time point
+ */
+double elapsed_seconds(chrono::steady_clock::time_point start);
+#endif
+
+#endif // SELFPLAYMETRICS_H
@@ -25,51 +25,324 @@
 
 #include "traindataexporter.h"
 #include <inttypes.h>
+#include <deque>
+#include <numeric>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include "thread.h"
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
 
-void TrainDataExporter::export_pos(const Board *pos, const EvalInfo& eval, size_t idxOffset)
+string get_process_shard_id()
 {
-    export_planes(pos, idxOffset);
-    export_policy(eval.legalMoves, eval.policyProbSmall, pos->side_to_move(), idxOffset);
-    // value will be set later in export_game_result()
+#ifdef _WIN32
+    return to_string(_getpid());
+#else
+    // the host name keeps the shards of different hosts apart if they write into a shared directory
+    char hostName[256] = "";
+    gethostname(hostName, sizeof(hostName) - 1);
+    return string(hostName) + "_" + to_string(getpid());
+#endif
 }
 
-void TrainDataExporter::export_best_move_q(const EvalInfo &eval, size_t idxOffset)
+size_t SampleBuffer::size() const
 {
+    return values.size();
+}
+
+/**
+ * @brief move_front Moves the first numberValues values of a vector to the end of another one
+ */
+template<typename T>
+void move_front(vector<T>& source, vector<T>& target, size_t numberValues)
+{
+    target.insert(target.end(), source.begin(), source.begin() + numberValues);
+    source.erase(source.begin(), source.begin() + numberValues);
+}
+
+/**
+ * @brief append_values Appends all values of a vector to another one
+ */
+template<typename T>
+void append_values(vector<T>& target, const vector<T>& source)
+{
+    target.insert(target.end(), source.begin(), source.end());
+}
+
+void SampleBuffer::append(const SampleBuffer& samples)
+{
+    append_values(planes, samples.planes);
+    append_values(policies, samples.policies);
+    append_values(bitboards, samples.bitboards);
+    append_values(scalars, samples.scalars);
+    append_values(policyIndices, samples.policyIndices);
+    append_values(policyProbs, samples.policyProbs);
+    append_values(policyLengths, samples.policyLengths);
+    append_values(values, samples.values);
+    append_values(bestMoveQs, samples.bestMoveQs);
+    append_values(gameEndIdxs, samples.gameEndIdxs);
+}
+
+SampleBuffer SampleBuffer::split(size_t numberSamples)
+{
+    SampleBuffer leading;
+    leading.startIdx = startIdx;
+    leading.gameIdx = gameIdx;
+    leading.policyStartIdx = policyStartIdx;
+    // only the buffers of the exported layout are filled
+    move_front(planes, leading.planes, min(planes.size(), numberSamples * NB_VALUES_TOTAL));
+    move_front(policies, leading.policies, min(policies.size(), numberSamples * NB_LABELS));
+    move_front(bitboards, leading.bitboards, min(bitboards.size(), numberSamples * NB_CHANNELS_TOTAL));
+    move_front(scalars, leading.scalars, min(scalars.size(), numberSamples * NB_CHANNELS_TOTAL));
+    const size_t numberEntries = accumulate(policyLengths.begin(), policyLengths.begin() + min(policyLengths.size(), numberSamples), size_t(0));
+    move_front(policyIndices, leading.policyIndices, numberEntries);
+    move_front(policyProbs, leading.policyProbs, numberEntries);
+    move_front(policyLengths, leading.policyLengths, min(policyLengths.size(), numberSamples));
+    move_front(values, leading.values, numberSamples);
+    move_front(bestMoveQs, leading.bestMoveQs, numberSamples);
+    policyStartIdx += numberEntries;
+
+    // a game belongs to the block which contains its last sample
+    const size_t splitIdx = startIdx + numberSamples;
+    size_t numberGames = 0;
+    while (numberGames < gameEndIdxs.size() && size_t(gameEndIdxs[numberGames]) <= splitIdx) {
+        ++numberGames;
+    }
+    leading.gameEndIdxs.assign(gameEndIdxs.begin(), gameEndIdxs.begin() + numberGames);
+    gameEndIdxs.erase(gameEndIdxs.begin(), gameEndIdxs.begin() + numberGames);
+    startIdx = splitIdx;
+    gameIdx += numberGames;
+    return leading;
+}
+
+void TrainDataExporter::add_sample(const Board *pos, const EvalInfo& eval, SampleBuffer& samples)
+{
+    add_planes(pos, samples);
+    add_policy(eval.legalMoves, eval.policyProbSmall, pos->side_to_move(), samples);
     // Q value of "best" move (a.k.a selected move after mcts search)
-    // write value to roi
-    z5::types::ShapeType offsetValue = { startIdx+idxOffset };
-    xt::xarray<float> qArray({ 1 }, eval.bestMoveQ);
+    samples.bestMoveQs.push_back(eval.bestMoveQ);
+    // value will be set later in add_game_result()
+}
 
-    z5::multiarray::writeSubarray<float>(dbestMoveQ, qArray, offsetValue.begin());
+void TrainDataExporter::add_game_result(const int16_t result, size_t ply, SampleBuffer& samples)
+{
+    // invert the result on every second ply
+    samples.values.push_back(ply % 2 == 0 ? result : -result);
 }
 
-void TrainDataExporter::export_game_result(const int16_t result, size_t idxOffset, size_t plys)
+void TrainDataExporter::export_game(const string& fen, Variant variant, const vector<EvalInfo>& evalInfos, const vector<bool>& exportMask, int16_t result)
 {
-    // value
-    // write value to roi
-    z5::types::ShapeType offsetValue = { startIdx+idxOffset };
-    xt::xarray<int16_t>::shape_type shapeValue = { plys };
-    xt::xarray<int16_t> valueArray(shapeValue, result);
+    assert(evalInfos.size() == exportMask.size());
+    const size_t numberSamples = count(exportMask.begin(), exportMask.end(), true);
+    if (numberSamples == 0) {
+        return;
+    }
+
+    Board pos;
+    deque<StateInfo> states(1);
+    auto uiThread = make_shared<Thread>(0);
+    pos.set(fen, false, variant, &states.back(), uiThread.get());
 
-    if (result != DRAW) {
-        // invert the result on every second ply
-        for (size_t idx = 1; idx < plys; idx+=2) {
-            valueArray.data()[idx] = -result;
+    // the samples are encoded without holding the lock
+    SampleBuffer gameSamples;
+    if (!isCompact) {
+        gameSamples.planes.reserve(numberSamples * NB_VALUES_TOTAL);
+        gameSamples.policies.reserve(numberSamples * NB_LABELS);
+    }
+    for (size_t ply = 0; ply < evalInfos.size(); ++ply) {
+        if (exportMask[ply]) {
+            add_sample(&pos, evalInfos[ply], gameSamples);
+            add_game_result(result, ply, gameSamples);
         }
+        states.emplace_back();
+        pos.do_move(evalInfos[ply].bestMove, states.back());
     }
+    // the states are owned by the deque
+    pos.setStateInfo(nullptr);
 
-    z5::multiarray::writeSubarray<int16_t>(dValue, valueArray, offsetValue.begin());
-    startIdx += plys;
+    lock_guard<mutex> lock(mtx);
+    startIdx += numberSamples;
     gameIdx++;
-    export_start_idx();
+    gameSamples.gameEndIdxs.push_back(int32_t(startIdx));
+    pendingSamples.append(gameSamples);
+    queue_full_chunks();
+}
+
+void TrainDataExporter::queue_full_chunks()
+{
+    const size_t endIdx = pendingSamples.startIdx + pendingSamples.size();
+    const size_t chunkBoundary = endIdx / chunckSize * chunckSize;
+    if (chunkBoundary > pendingSamples.startIdx) {
+        writeQueue.push_back(pendingSamples.split(chunkBoundary - pendingSamples.startIdx));
+        queueChanged.notify_all();
+    }
+}
+
+void TrainDataExporter::flush()
+{
+    unique_lock<mutex> lock(mtx);
+    if (pendingSamples.size() != 0) {
+        writeQueue.push_back(pendingSamples.split(pendingSamples.size()));
+        queueChanged.notify_all();
+    }
+    queueChanged.wait(lock, [&]{ return writeQueue.empty() && !isWriting; });
+}
+
+void TrainDataExporter::run_writer()
+{
+    unique_lock<mutex> lock(mtx);
+    while (true) {
+        queueChanged.wait(lock, [&]{ return !writeQueue.empty() || !isWriterRunning; });
+        if (writeQueue.empty()) {
+            return;
+        }
+        const SampleBuffer samples = move(writeQueue.front());
+        writeQueue.pop_front();
+        isWriting = true;
+        lock.unlock();
+        write_samples(samples);
+        lock.lock();
+        isWriting = false;
+        queueChanged.notify_all();
+    }
+}
+
+void TrainDataExporter::write_compact_samples(const SampleBuffer& samples)
+{
+    const size_t numberSamples = samples.size();
+    const size_t endIdx = samples.startIdx + numberSamples;
+    grow_dataset(dBitboards, "x_bitboards", endIdx);
+    grow_dataset(dScalars, "x_scalars", endIdx);
+    grow_dataset(dPolicyStart, "y_policy_start", endIdx);
+    grow_dataset(dPolicyLength, "y_policy_length", endIdx);
+
+    z5::types::ShapeType offsetChannels = { samples.startIdx, 0 };
+    xt::xarray<uint64_t> bitboards({ numberSamples, NB_CHANNELS_TOTAL });
+    copy(samples.bitboards.begin(), samples.bitboards.end(), bitboards.data());
+    z5::multiarray::writeSubarray<uint64_t>(dBitboards, bitboards, offsetChannels.begin());
+
+    xt::xarray<int16_t> scalars({ numberSamples, NB_CHANNELS_TOTAL });
+    copy(samples.scalars.begin(), samples.scalars.end(), scalars.data());
+    z5::multiarray::writeSubarray<int16_t>(dScalars, scalars, offsetChannels.begin());
+
+    // the sparse entries are stored consecutively, every sample references its entries by start index and length
+    z5::types::ShapeType offsetSample = { samples.startIdx };
+    xt::xarray<int64_t> policyStarts({ numberSamples });
+    size_t policyStartIdx = samples.policyStartIdx;
+    for (size_t idx = 0; idx < numberSamples; ++idx) {
+        policyStarts[idx] = int64_t(policyStartIdx);
+        policyStartIdx += samples.policyLengths[idx];
+    }
+    z5::multiarray::writeSubarray<int64_t>(dPolicyStart, policyStarts, offsetSample.begin());
+
+    xt::xarray<int16_t> policyLengths({ numberSamples });
+    copy(samples.policyLengths.begin(), samples.policyLengths.end(), policyLengths.data());
+    z5::multiarray::writeSubarray<int16_t>(dPolicyLength, policyLengths, offsetSample.begin());
+
+    if (!samples.policyIndices.empty()) {
+        grow_dataset(dPolicyIdx, "y_policy_idx", samples.policyStartIdx + samples.policyIndices.size());
+        grow_dataset(dPolicyProb, "y_policy_prob", samples.policyStartIdx + samples.policyProbs.size());
+        z5::types::ShapeType offsetEntries = { samples.policyStartIdx };
+        xt::xarray<int16_t> policyIndices({ samples.policyIndices.size() });
+        copy(samples.policyIndices.begin(), samples.policyIndices.end(), policyIndices.data());
+        z5::multiarray::writeSubarray<int16_t>(dPolicyIdx, policyIndices, offsetEntries.begin());
+
+        xt::xarray<float> policyProbs({ samples.policyProbs.size() });
+        copy(samples.policyProbs.begin(), samples.policyProbs.end(), policyProbs.data());
+        z5::multiarray::writeSubarray<float>(dPolicyProb, policyProbs, offsetEntries.begin());
+    }
 }
 
-TrainDataExporter::TrainDataExporter()
+void TrainDataExporter::write_samples(const SampleBuffer& samples)
+{
+    const size_t numberSamples = samples.size();
+    const size_t endIdx = samples.startIdx + numberSamples;
+    grow_dataset(dValue, "y_value", endIdx);
+    grow_dataset(dbestMoveQ, "y_best_move_q", endIdx);
+
+    if (isCompact) {
+        write_compact_samples(samples);
+    }
+    else {
+        grow_dataset(dx, "x", endIdx);
+        grow_dataset(dPolicy, "y_policy", endIdx);
+
+        // x / plane representation
+        z5::types::ShapeType offsetPlanes = { samples.startIdx, 0, 0, 0 };
+        xt::xarray<int16_t> planes({ numberSamples, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH });
+        copy(samples.planes.begin(), samples.planes.end(), planes.data());
+        z5::multiarray::writeSubarray<int16_t>(dx, planes, offsetPlanes.begin());
+
+        z5::types::ShapeType offsetPolicy = { samples.startIdx, 0 };
+        xt::xarray<float> policies({ numberSamples, NB_LABELS });
+        copy(samples.policies.begin(), samples.policies.end(), policies.data());
+        z5::multiarray::writeSubarray<float>(dPolicy, policies, offsetPolicy.begin());
+    }
+
+    z5::types::ShapeType offsetValue = { samples.startIdx };
+    xt::xarray<int16_t> values({ numberSamples });
+    copy(samples.values.begin(), samples.values.end(), values.data());
+    z5::multiarray::writeSubarray<int16_t>(dValue, values, offsetValue.begin());
+
+    xt::xarray<float> bestMoveQs({ numberSamples });
+    copy(samples.bestMoveQs.begin(), samples.bestMoveQs.end(), bestMoveQs.data());
+    z5::multiarray::writeSubarray<float>(dbestMoveQ, bestMoveQs, offsetValue.begin());
+
+    if (!samples.gameEndIdxs.empty()) {
+        // the end of a game is the starting index of the next game
+        const size_t nextGameIdx = samples.gameIdx + samples.gameEndIdxs.size();
+        grow_dataset(dStartIndex, "starting_idx", nextGameIdx + 1);
+        z5::types::ShapeType offsetStartIdx = { samples.gameIdx + 1 };
+        xt::xarray<int32_t> gameStartIdxs({ samples.gameEndIdxs.size() });
+        copy(samples.gameEndIdxs.begin(), samples.gameEndIdxs.end(), gameStartIdxs.data());
+        z5::multiarray::writeSubarray<int32_t>(dStartIndex, gameStartIdxs, offsetStartIdx.begin());
+
+        // a later run continues after the last complete game
+        const size_t nextStartIdx = samples.gameEndIdxs.back();
+        const size_t nextPolicyStartIdx = samples.policyStartIdx + accumulate(samples.policyLengths.begin(),
+                                                                              samples.policyLengths.begin() + min(samples.policyLengths.size(), nextStartIdx - samples.startIdx),
+                                                                              size_t(0));
+        export_manifest(nextStartIdx, nextGameIdx, nextPolicyStartIdx);
+    }
+}
+
+void TrainDataExporter::grow_dataset(unique_ptr<z5::Dataset>& dataset, const string& name, size_t length)
+{
+    if (length <= dataset->shape(0)) {
+        return;
+    }
+    const size_t chunkLength = dataset->defaultChunkShape()[0];
+    const size_t newLength = (length + chunkLength - 1) / chunkLength * chunkLength;
+
+    // z5 takes the shape from the zarr metadata of the dataset, so the metadata is updated and the dataset is opened again
+    const string metadataFileName = fileName + "/" + name + "/.zarray";
+    nlohmann::json metadata;
+    ifstream metadataIn(metadataFileName);
+    metadataIn >> metadata;
+    metadataIn.close();
+    metadata["shape"][0] = newLength;
+    ofstream metadataOut(metadataFileName);
+    metadataOut << metadata.dump();
+    metadataOut.close();
+    dataset = z5::openDataset(z5::filesystem::handle::File(fileName), name);
+}
+
+TrainDataExporter::TrainDataExporter(const string& shardId, bool isCompact):
+    shardId(shardId),
+    fileName("data_" + shardId + ".zarr"),
+    manifestFileName("data_" + shardId + ".json"),
+    isCompact(isCompact),
+    isWriterRunning(true),
+    isWriting(false)
 {
     gameIdx = 0;
     startIdx = 0;
+    policyStartIdx = 0;
     chunckSize = 128;
-    const string fileName = "data.zarr";  // TODO: Change to a generic filename
     // get handle to a File on the filesystem
     z5::filesystem::handle::File file(fileName);
 
@@ -79,80 +352,114 @@ TrainDataExporter::TrainDataExporter()
     else {
         create_new_dataset_file(file);
     }
+    pendingSamples.startIdx = startIdx;
+    pendingSamples.gameIdx = gameIdx;
+    pendingSamples.policyStartIdx = policyStartIdx;
+    writer = thread(&TrainDataExporter::run_writer, this);
 }
 
-void TrainDataExporter::export_planes(const Board *pos, size_t idxOffset)
+TrainDataExporter::~TrainDataExporter()
+{
+    flush();
+    {
+        lock_guard<mutex> lock(mtx);
+        isWriterRunning = false;
+        queueChanged.notify_all();
+    }
+    writer.join();
+}
+
+void TrainDataExporter::add_planes(const Board *pos, SampleBuffer& samples)
 {
     // x / plane representation
     float inputPlanes[NB_VALUES_TOTAL];
     board_to_planes(pos, 0, false, inputPlanes);
-    // write array to roi
-    z5::types::ShapeType offsetPlanes = { startIdx+idxOffset, 0, 0, 0 };
-    xt::xarray<int16_t>::shape_type policyShape = { 1, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH };
-    xt::xarray<int16_t> policy(policyShape);
+    if (isCompact) {
+        const size_t offset = samples.bitboards.size();
+        samples.bitboards.resize(offset + NB_CHANNELS_TOTAL);
+        samples.scalars.resize(offset + NB_CHANNELS_TOTAL);
+        if (!compress_planes(inputPlanes, &samples.bitboards[offset], &samples.scalars[offset])) {
+            cerr << "info string warning: input planes of " << pos->fen() << " aren't binary or constant" << endl;
+        }
+        return;
+    }
     for (size_t idx = 0; idx < NB_VALUES_TOTAL; ++idx) {
-        policy.data()[idx] = int16_t(inputPlanes[idx]);
+        samples.planes.push_back(int16_t(inputPlanes[idx]));
     }
-    z5::multiarray::writeSubarray<int16_t>(dx, policy, offsetPlanes.begin());
 }
 
-void TrainDataExporter::export_policy(const vector<Move>& legalMoves, const DynamicVector<float>& policyProbSmall, Color sideToMove, size_t idxOffset)
+void TrainDataExporter::add_policy(const vector<Move>& legalMoves, const DynamicVector<float>& policyProbSmall, Color sideToMove, SampleBuffer& samples)
 {
     assert(legalMoves.size() == policyProbSmall.size());
 
-    // write array to roi
-    z5::types::ShapeType offsetPolicy = { startIdx+idxOffset, 0 };
-    xt::xarray<float>::shape_type shapePolicy = { 1, NB_LABELS };
-    xt::xarray<float> policy(shapePolicy, 0);
+    if (isCompact) {
+        const size_t numberEntries = compress_policy(legalMoves, policyProbSmall, sideToMove, samples.policyIndices, samples.policyProbs);
+        samples.policyLengths.push_back(int16_t(numberEntries));
+        return;
+    }
 
+    const size_t offset = samples.policies.size();
+    samples.policies.resize(offset + NB_LABELS, 0);
     for (size_t idx = 0; idx < legalMoves.size(); ++idx) {
-        size_t policyIdx;
-        if (sideToMove == WHITE) {
-            policyIdx = MV_LOOKUP_CLASSIC[legalMoves[idx]];
-        }
-        else {
-            policyIdx = MV_LOOKUP_MIRRORED_CLASSIC[legalMoves[idx]];
-        }
-        policy[policyIdx] = policyProbSmall[idx];
+        samples.policies[offset + get_policy_index(legalMoves[idx], sideToMove)] = policyProbSmall[idx];
     }
-    z5::multiarray::writeSubarray<float>(dPolicy, policy, offsetPolicy.begin());
-
 }
 
-void TrainDataExporter::export_start_idx()
+void TrainDataExporter::export_manifest(size_t nextStartIdx, size_t nextGameIdx, size_t nextPolicyStartIdx)
 {
-    // gameStartIdx
-    // write value to roi
-    z5::types::ShapeType offsetStartIdx = { gameIdx };
-    xt::xarray<int32_t> arrayGameStartIdx({ 1 }, int32_t(startIdx));
-    z5::multiarray::writeSubarray<int32_t>(dStartIndex, arrayGameStartIdx, offsetStartIdx.begin());
+    nlohmann::json manifest;
+    manifest["shard_id"] = shardId;
+    manifest["file"] = fileName;
+    manifest["layout"] = isCompact ? "compact" : "dense";
+    manifest["chunk_size"] = chunckSize;
+    manifest["nb_channels"] = NB_CHANNELS_TOTAL;
+    manifest["nb_labels"] = NB_LABELS;
+    // only the samples of complete games are valid, the datasets may contain further samples of an interrupted run
+    manifest["number_samples"] = nextStartIdx;
+    manifest["number_games"] = nextGameIdx;
+    if (isCompact) {
+        manifest["number_policy_entries"] = nextPolicyStartIdx;
+    }
 
-    ofstream startIdxFile;
-    startIdxFile.open("startIdx.txt");
-    // set the next startIdx to continue
-    startIdxFile << startIdx;
-    startIdxFile.close();
-    ofstream gameIdxFile;
-    gameIdxFile.open("gameIdxFile.txt");
-    gameIdxFile << gameIdx;
-    gameIdxFile.close();
+    // the manifest is replaced atomically, so that a merge step never reads a partially written file
+    const string tmpFileName = manifestFileName + ".tmp";
+    ofstream manifestFile(tmpFileName);
+    manifestFile << manifest.dump(4) << endl;
+    manifestFile.close();
+    rename(tmpFileName.c_str(), manifestFileName.c_str());
 }
 
 void TrainDataExporter::open_dataset_from_file(const z5::filesystem::handle::File& file)
 {
     dStartIndex = z5::openDataset(file,"starting_idx");
-    dx = z5::openDataset(file,"x");
     dValue = z5::openDataset(file,"y_value");
-    dPolicy = z5::openDataset(file,"y_policy");
     dbestMoveQ = z5::openDataset(file, "y_best_move_q");
-    ifstream startIdxFile;
-    startIdxFile.open("startIdx.txt");
-    startIdxFile >> startIdx;
-    startIdxFile.close();
-    ifstream gameIdxFile;
-    gameIdxFile.open("gameIdxFile.txt");
-    gameIdxFile >> gameIdx;
-    gameIdxFile.close();
+    isCompact = z5::filesystem::handle::Dataset(file, "x_bitboards").exists();
+    if (isCompact) {
+        dBitboards = z5::openDataset(file, "x_bitboards");
+        dScalars = z5::openDataset(file, "x_scalars");
+        dPolicyIdx = z5::openDataset(file, "y_policy_idx");
+        dPolicyProb = z5::openDataset(file, "y_policy_prob");
+        dPolicyStart = z5::openDataset(file, "y_policy_start");
+        dPolicyLength = z5::openDataset(file, "y_policy_length");
+    }
+    else {
+        dx = z5::openDataset(file,"x");
+        dPolicy = z5::openDataset(file,"y_policy");
+    }
+
+    // continue after the last complete game of the previous run
+    ifstream manifestFile(manifestFileName);
+    if (!manifestFile.is_open()) {
+        cerr << "info string warning: " << manifestFileName << " is missing, the samples of " << fileName << " will be overwritten" << endl;
+        return;
+    }
+    nlohmann::json manifest;
+    manifestFile >> manifest;
+    manifestFile.close();
+    startIdx = manifest["number_samples"];
+    gameIdx = manifest["number_games"];
+    policyStartIdx = manifest.value("number_policy_entries", size_t(0));
 }
 
 void TrainDataExporter::create_new_dataset_file(const z5::filesystem::handle::File &file)
@@ -162,16 +469,30 @@ void TrainDataExporter::create_new_dataset_file(const z5::filesystem::handle::Fi
     z5::createFile(file, createAsZarr);
 
     z5::createGroup(file, "group");
-    const size_t numberChunks = 8;
-
-    // create a new zarr dataset
-    std::vector<size_t> shape = { chunckSize*numberChunks, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH };
-    std::vector<size_t> chunks = { chunckSize, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH };
-    dStartIndex = z5::createDataset(file, "starting_idx", "int32", { chunckSize*numberChunks }, { chunckSize });
-    dx = z5::createDataset(file, "x", "int16", shape, chunks);
-    dValue = z5::createDataset(file, "y_value", "int16", { chunckSize*numberChunks }, { chunckSize });
-    dPolicy = z5::createDataset(file, "y_policy", "float32", { chunckSize*numberChunks, NB_LABELS }, { chunckSize, NB_LABELS });
-    dbestMoveQ = z5::createDataset(file, "y_best_move_q", "float32", { chunckSize*numberChunks }, { chunckSize });
-
-    export_start_idx();
+
+    // all datasets start with a single chunk and grow in chunk units while the samples are written
+    std::vector<size_t> shape = { chunckSize, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH };
+    dStartIndex = z5::createDataset(file, "starting_idx", "int32", { chunckSize }, { chunckSize });
+    dValue = z5::createDataset(file, "y_value", "int16", { chunckSize }, { chunckSize });
+    dbestMoveQ = z5::createDataset(file, "y_best_move_q", "float32", { chunckSize }, { chunckSize });
+    if (isCompact) {
+        dBitboards = z5::createDataset(file, "x_bitboards", "uint64", { chunckSize, NB_CHANNELS_TOTAL }, { chunckSize, NB_CHANNELS_TOTAL });
+        dScalars = z5::createDataset(file, "x_scalars", "int16", { chunckSize, NB_CHANNELS_TOTAL }, { chunckSize, NB_CHANNELS_TOTAL });
+        dPolicyStart = z5::createDataset(file, "y_policy_start", "int64", { chunckSize }, { chunckSize });
+        dPolicyLength = z5::createDataset(file, "y_policy_length", "int16", { chunckSize }, { chunckSize });
+        // a chunk of sparse policy entries holds about the entries of a chunk of samples
+        const size_t policyChunkSize = chunckSize * 32;
+        dPolicyIdx = z5::createDataset(file, "y_policy_idx", "int16", { policyChunkSize }, { policyChunkSize });
+        dPolicyProb = z5::createDataset(file, "y_policy_prob", "float32", { policyChunkSize }, { policyChunkSize });
+    }
+    else {
+        dx = z5::createDataset(file, "x", "int16", shape, shape);
+        dPolicy = z5::createDataset(file, "y_policy", "float32", { chunckSize, NB_LABELS }, { chunckSize, NB_LABELS });
+    }
+
+    // the first game starts at index 0
+    z5::types::ShapeType offsetStartIdx = { 0 };
+    xt::xarray<int32_t> arrayGameStartIdx({ 1 }, 0);
+    z5::multiarray::writeSubarray<int32_t>(dStartIndex, arrayGameStartIdx, offsetStartIdx.begin());
+    export_manifest(0, 0, 0);
 }
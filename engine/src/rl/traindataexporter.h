@@ -22,13 +22,21 @@
  * Created on 12.09.2019
  * @author: queensgambit
  *
- * Exporter class which saves the board position in planes (x) and the target values (y) for NN training
+ * Exporter class which saves the board position in planes (x) and the target values (y) for NN training.
+ * The samples of finished games are buffered in memory and written by a background thread in chunk-aligned blocks.
+ * Optionally, the samples are stored in the compact layout of compactsample.h which can be expanded by TrainDataReader.
+ * Every exporter writes its own shard data_<shardId>.zarr whose datasets grow in chunk units.
+ * The manifest data_<shardId>.json describes the complete games of the shard, so that the shards can be merged later.
  */
 
 #ifndef TRAINDATAEXPORTER_H
 #define TRAINDATAEXPORTER_H
 
 #include <string>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <condition_variable>
 
 #include "nlohmann/json.hpp"
 #include "xtensor/xarray.hpp"
@@ -42,48 +50,176 @@
 #include "../domain/crazyhouse/constants.h"
 
 #include "../board.h"
-#include "../domain/crazyhouse/constants.h"
 #include "../node.h"
 #include "../evalinfo.h"
+#include "compactsample.h"
+
+/**
+ * @brief The SampleBuffer struct holds encoded training samples of consecutive dataset indices which haven't been written yet
+ */
+struct SampleBuffer
+{
+    // dataset index of the first sample
+    size_t startIdx;
+    // number of games which ended before this buffer
+    size_t gameIdx;
+    // dataset index of the first sparse policy entry (compact layout)
+    size_t policyStartIdx;
+    // NB_VALUES_TOTAL values per sample (dense layout)
+    vector<int16_t> planes;
+    // NB_LABELS values per sample (dense layout)
+    vector<float> policies;
+    // NB_CHANNELS_TOTAL values per sample (compact layout)
+    vector<uint64_t> bitboards;
+    vector<int16_t> scalars;
+    // sparse policy entries of all samples and the number of entries per sample (compact layout)
+    vector<int16_t> policyIndices;
+    vector<float> policyProbs;
+    vector<int16_t> policyLengths;
+    vector<int16_t> values;
+    vector<float> bestMoveQs;
+    // dataset indices at which the games that end in this buffer end, i.e. the starting index of the following game
+    vector<int32_t> gameEndIdxs;
+
+    size_t size() const;
+
+    /**
+     * @brief append Appends the samples of the given buffer
+     */
+    void append(const SampleBuffer& samples);
+
+    /**
+     * @brief split Moves the first numberSamples samples and the games which end within them into a new buffer
+     * @param numberSamples Number of samples to move
+     * @return Buffer with the leading samples
+     */
+    SampleBuffer split(size_t numberSamples);
+};
+
+/**
+ * @brief get_process_shard_id Returns a shard id which is unique for the current process
+ * @return Host name and process id
+ */
+string get_process_shard_id();
 
 class TrainDataExporter
 {
 private:
+    string shardId;
+    // zarr file of the shard
+    string fileName;
+    // json file which describes the exported games of the shard
+    string manifestFileName;
     size_t chunckSize;
     std::unique_ptr<z5::Dataset> dStartIndex;
     std::unique_ptr<z5::Dataset> dx;
     std::unique_ptr<z5::Dataset> dValue;
     std::unique_ptr<z5::Dataset> dPolicy;
     std::unique_ptr<z5::Dataset> dbestMoveQ;
-
+    // datasets of the compact layout which replace dx and dPolicy
+    std::unique_ptr<z5::Dataset> dBitboards;
+    std::unique_ptr<z5::Dataset> dScalars;
+    std::unique_ptr<z5::Dataset> dPolicyIdx;
+    std::unique_ptr<z5::Dataset> dPolicyProb;
+    std::unique_ptr<z5::Dataset> dPolicyStart;
+    std::unique_ptr<z5::Dataset> dPolicyLength;
+    // true, if the samples are stored in the compact layout
+    bool isCompact;
     // current number of games - 1
     size_t gameIdx;
     // current sample index to insert
     size_t startIdx;
+    // current sparse policy entry index to insert (compact layout)
+    size_t policyStartIdx;
+
+    // samples of finished games which don't fill a chunk yet
+    SampleBuffer pendingSamples;
+    // chunk-aligned blocks which are waiting for the writer thread
+    deque<SampleBuffer> writeQueue;
+    // protects all members above which change after construction
+    mutex mtx;
+    condition_variable queueChanged;
+    thread writer;
+    bool isWriterRunning;
+    // true while the writer thread is writing a block which has already been removed from the queue
+    bool isWriting;
+
+    /**
+     * @brief add_sample Encodes the board position, the policy and the best move Q-value of a single sample
+     * @param pos Current board position
+     * @param eval Filled EvalInfo struct after mcts search
+     * @param samples Buffer which receives the sample
+     */
+    void add_sample(const Board *pos, const EvalInfo& eval, SampleBuffer& samples);
 
     /**
-     * @brief export_planes Exports the board in plane representation (x)
+     * @brief add_planes Encodes the board in plane representation (x)
      * @param pos Board position to export
-     * @param idxOffset Batch-Offset where to save it in the matrix
+     * @param samples Buffer which receives the planes
      */
-    void export_planes(const Board *pos, size_t idxOffset);
+    void add_planes(const Board *pos, SampleBuffer& samples);
 
     /**
-     * @brief export_policy Export the policy (e.g. mctsPolicy) to the matrix
+     * @brief add_policy Encodes the policy (e.g. mctsPolicy) as a dense vector or as sparse entries
      * @param legalMoves List of legal moves
      * @param policyProbSmall Probability for each move
      * @param sideToMove Current side to move
-     * @param idxOffset Batch-Offset where to save it in the matrix
+     * @param samples Buffer which receives the policy
+     */
+    void add_policy(const vector<Move>& legalMoves, const DynamicVector<float>& policyProbSmall, Color sideToMove, SampleBuffer& samples);
+
+    /**
+     * @brief add_game_result Assigns the game result, (Monte-Carlo value result) to the sample of the given ply.
+     * The value is inversed after each step.
+     * @param result Game match result: LOST, DRAW, WON
+     * @param ply Halfmove of the sample within the game
+     * @param samples Buffer which receives the value
      */
-    void export_policy(const vector<Move>& legalMoves, const DynamicVector<float>& policyProbSmall, Color sideToMove, size_t idxOffset);
+    void add_game_result(const int16_t result, size_t ply, SampleBuffer& samples);
 
     /**
-     * @brief export_start_idx Writes the current starting index where to continue inserting in a .txt-file
+     * @brief queue_full_chunks Moves all samples up to the last completed chunk boundary to the write queue.
+     * It must be called while holding the lock.
      */
-    void export_start_idx();
+    void queue_full_chunks();
 
     /**
-     * @brief open_dataset_from_file Reads a previously exported training set back into memory
+     * @brief write_samples Writes a block of samples with a single write per dataset and updates the manifest
+     * @param samples Samples of consecutive dataset indices
+     */
+    void write_samples(const SampleBuffer& samples);
+
+    /**
+     * @brief write_compact_samples Writes the planes and policies of a block of samples in the compact layout
+     * @param samples Samples of consecutive dataset indices
+     */
+    void write_compact_samples(const SampleBuffer& samples);
+
+    /**
+     * @brief run_writer Loop of the writer thread which writes the queued blocks until the exporter is destroyed
+     */
+    void run_writer();
+
+    /**
+     * @brief export_manifest Writes the number of exported samples, games and sparse policy entries to the manifest of the shard.
+     * They are also used to continue the shard in a later run.
+     * @param nextStartIdx Index of the next sample
+     * @param nextGameIdx Index of the next game
+     * @param nextPolicyStartIdx Index of the next sparse policy entry (compact layout)
+     */
+    void export_manifest(size_t nextStartIdx, size_t nextGameIdx, size_t nextPolicyStartIdx);
+
+    /**
+     * @brief grow_dataset Extends the first dimension of a dataset to the next multiple of its chunk length if it is shorter than the given length
+     * @param dataset Dataset which is opened again after resizing
+     * @param name Name of the dataset
+     * @param length Required length of the first dimension
+     */
+    void grow_dataset(std::unique_ptr<z5::Dataset>& dataset, const string& name, size_t length);
+
+    /**
+     * @brief open_dataset_from_file Opens a previously exported shard, so that its games are continued.
+     * The layout of the existing file is kept.
      * @param file filesystem handle
      */
     void open_dataset_from_file(const z5::filesystem::handle::File& file);
@@ -95,31 +231,35 @@ private:
     void create_new_dataset_file(const z5::filesystem::handle::File& file);
 
 public:
-    TrainDataExporter();
+    /**
+     * @brief TrainDataExporter
+     * @param shardId Id of the shard, an existing shard with the same id is continued
+     * @param isCompact True, if new data sets shall be stored in the compact layout
+     */
+    TrainDataExporter(const string& shardId, bool isCompact);
 
     /**
-     * @brief export_pos Exports a given board position with result to the current training set
-     * @param pos Current board position
-     * @param eval Filled EvalInfo struct after mcts search
-     * @param idxOffset Starting index where to start storing the training sample
+     * @brief ~TrainDataExporter Writes all remaining samples and stops the writer thread
      */
-    void export_pos(const Board *pos, const EvalInfo& eval, size_t idxOffset);
+    ~TrainDataExporter();
 
     /**
-     * @brief export_best_move_q Export the Q-value of the move which was selected after MCTS search(Optional training sample feature)
-     * @param eval Filled EvalInfo struct after mcts search
-     * @param idxOffset Starting index where to start storing the training sample
+     * @brief export_game Exports the selected positions of a finished game together with the game result.
+     * The positions are replayed from the starting position, so that a game only needs to keep its search results in memory.
+     * The samples are encoded by the calling thread and written later by the writer thread.
+     * This function can be called concurrently by several games.
+     * @param fen Starting position of the game
+     * @param variant Chess variant
+     * @param evalInfos Search results of every played move, the best move of each entry is the move which was played
+     * @param exportMask Defines for every move if its position is exported, e.g. only the positions of full searches
+     * @param result Game result from the perspective of the first side to move: LOSS, DRAW, WIN
      */
-    void export_best_move_q(const EvalInfo& eval, size_t idxOffset);
+    void export_game(const string& fen, Variant variant, const vector<EvalInfo>& evalInfos, const vector<bool>& exportMask, int16_t result);
 
     /**
-     * @brief export_game_result Assigns the game result, (Monte-Carlo value result) to every training sample.
-     * The value is inversed after each step.
-     * @param result Game match result: LOST, DRAW, WON
-     * @param idxOffset Starting index where to start assigning values
-     * @param plys Number of training samples (halfmoves/plys) for the current match
+     * @brief flush Queues the remaining samples even if they don't fill a chunk and blocks until everything has been written
      */
-    void export_game_result(const int16_t result, size_t idxOffset, size_t plys);
+    void flush();
 };
 
 #endif // TRAINDATAEXPORTER_H
@@ -0,0 +1,84 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: traindatareader.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "traindatareader.h"
+#include <algorithm>
+#include "compactsample.h"
+
+#ifdef USE_RL
+TrainDataReader::TrainDataReader(const std::string& fileName):
+    file(fileName)
+{
+    isCompact = z5::filesystem::handle::Dataset(file, "x_bitboards").exists();
+}
+
+bool TrainDataReader::is_compact() const
+{
+    return isCompact;
+}
+
+void TrainDataReader::read_samples(size_t startIdx, size_t numberSamples, xt::xarray<int16_t>& planes, xt::xarray<float>& policies)
+{
+    planes = xt::xarray<int16_t>({ numberSamples, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH });
+    policies = xt::xarray<float>({ numberSamples, NB_LABELS });
+
+    if (!isCompact) {
+        z5::types::ShapeType offsetPlanes = { startIdx, 0, 0, 0 };
+        z5::multiarray::readSubarray<int16_t>(z5::openDataset(file, "x"), planes, offsetPlanes.begin());
+        z5::types::ShapeType offsetPolicy = { startIdx, 0 };
+        z5::multiarray::readSubarray<float>(z5::openDataset(file, "y_policy"), policies, offsetPolicy.begin());
+        return;
+    }
+
+    z5::types::ShapeType offsetChannels = { startIdx, 0 };
+    xt::xarray<uint64_t> bitboards({ numberSamples, NB_CHANNELS_TOTAL });
+    z5::multiarray::readSubarray<uint64_t>(z5::openDataset(file, "x_bitboards"), bitboards, offsetChannels.begin());
+    xt::xarray<int16_t> scalars({ numberSamples, NB_CHANNELS_TOTAL });
+    z5::multiarray::readSubarray<int16_t>(z5::openDataset(file, "x_scalars"), scalars, offsetChannels.begin());
+
+    z5::types::ShapeType offsetSample = { startIdx };
+    xt::xarray<int64_t> policyStarts({ numberSamples });
+    z5::multiarray::readSubarray<int64_t>(z5::openDataset(file, "y_policy_start"), policyStarts, offsetSample.begin());
+    xt::xarray<int16_t> policyLengths({ numberSamples });
+    z5::multiarray::readSubarray<int16_t>(z5::openDataset(file, "y_policy_length"), policyLengths, offsetSample.begin());
+
+    // the sparse entries of consecutive samples are stored consecutively
+    const size_t numberEntries = size_t(policyStarts[numberSamples-1] - policyStarts[0]) + size_t(policyLengths[numberSamples-1]);
+    xt::xarray<int16_t> policyIndices({ max(numberEntries, size_t(1)) });
+    xt::xarray<float> policyProbs({ max(numberEntries, size_t(1)) });
+    if (numberEntries != 0) {
+        z5::types::ShapeType offsetEntries = { size_t(policyStarts[0]) };
+        z5::multiarray::readSubarray<int16_t>(z5::openDataset(file, "y_policy_idx"), policyIndices, offsetEntries.begin());
+        z5::multiarray::readSubarray<float>(z5::openDataset(file, "y_policy_prob"), policyProbs, offsetEntries.begin());
+    }
+
+    for (size_t idx = 0; idx < numberSamples; ++idx) {
+        expand_planes(bitboards.data() + idx * NB_CHANNELS_TOTAL, scalars.data() + idx * NB_CHANNELS_TOTAL, planes.data() + idx * NB_VALUES_TOTAL);
+        const size_t entryIdx = size_t(policyStarts[idx] - policyStarts[0]);
+        expand_policy(policyIndices.data() + entryIdx, policyProbs.data() + entryIdx, size_t(policyLengths[idx]), policies.data() + idx * NB_LABELS);
+    }
+}
+#endif
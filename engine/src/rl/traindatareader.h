@@ -0,0 +1,68 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: traindatareader.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Reader for the training data of TrainDataExporter which returns the planes (x) and policy targets (y_policy)
+ * in the dense layout independent of the layout in which they were exported.
+ */
+
+#ifndef TRAINDATAREADER_H
+#define TRAINDATAREADER_H
+
+#include <string>
+#include "xtensor/xarray.hpp"
+#include "z5/factory.hxx"
+#include "z5/filesystem/handle.hxx"
+#include "z5/multiarray/xtensor_access.hxx"
+#include "z5/dataset.hxx"
+
+#ifdef USE_RL
+class TrainDataReader
+{
+private:
+    z5::filesystem::handle::File file;
+    // true, if the file was exported in the compact layout
+    bool isCompact;
+
+public:
+    /**
+     * @brief TrainDataReader
+     * @param fileName Zarr file which has been written by TrainDataExporter
+     */
+    TrainDataReader(const std::string& fileName);
+
+    bool is_compact() const;
+
+    /**
+     * @brief read_samples Reads a range of samples and expands them to the dense layout if necessary
+     * @param startIdx Dataset index of the first sample
+     * @param numberSamples Number of samples to read
+     * @param planes Output of shape (numberSamples, NB_CHANNELS_TOTAL, BOARD_HEIGHT, BOARD_WIDTH)
+     * @param policies Output of shape (numberSamples, NB_LABELS)
+     */
+    void read_samples(size_t startIdx, size_t numberSamples, xt::xarray<int16_t>& planes, xt::xarray<float>& policies);
+};
+#endif
+
+#endif // TRAINDATAREADER_H
@@ -28,20 +28,26 @@
 #include "outputrepresentation.h"
 #include "uci.h"
 
-SearchThread::SearchThread(NeuralNetAPI *netBatch, SearchSettings* searchSettings, unordered_map<Key, Node *> *hashTable):
-    netBatch(netBatch), isRunning(false), hashTable(hashTable), searchSettings(searchSettings)
+SearchThread::SearchThread(NeuralNetAPI *netBatch, SearchSettings* searchSettings, unordered_map<Key, Node *> *hashTable, mutex* hashTableMtx, NNCache* nnCache):
+    netBatch(netBatch), sharedNetBatch(nullptr), slotIdx(0), isPolicyMap(netBatch->is_policy_map()),
+    isRunning(false), numberMiniBatches(0), numberEvaluatedNodes(0), numberSelections(0), numberCollisions(0), hashTable(hashTable), hashTableMtx(hashTableMtx), nnCache(nnCache), searchSettings(searchSettings)
 {
     // allocate memory for all predictions and results
-    inputPlanes = new float[searchSettings->batchSize * NB_VALUES_TOTAL];
-    valueOutputs = new NDArray(Shape(searchSettings->batchSize, 1), Context::cpu());
-
-    bool select_policy_from_plane = true;
+    // the planes are written directly into the input memory of the network
+    inputPlanes = netBatch->get_input_planes();
+    // the outputs will point into the memory of netBatch after the first prediction
+    valueOutputs = nullptr;
+    probOutputs = nullptr;
+    searchLimits = nullptr;  // will be set by set_search_limits() every time before go()
+}
 
-    if (select_policy_from_plane) {
-        probOutputs = new NDArray(Shape(searchSettings->batchSize, NB_LABELS_POLICY_MAP), Context::cpu());
-    } else {
-        probOutputs = new NDArray(Shape(searchSettings->batchSize, NB_LABELS), Context::cpu());
-    }
+SearchThread::SearchThread(SharedNetBatch* sharedNetBatch, size_t slotIdx, SearchSettings* searchSettings, unordered_map<Key, Node*>* hashTable, mutex* hashTableMtx, NNCache* nnCache):
+    netBatch(nullptr), sharedNetBatch(sharedNetBatch), slotIdx(slotIdx), isPolicyMap(sharedNetBatch->is_policy_map()),
+    isRunning(false), numberMiniBatches(0), numberEvaluatedNodes(0), numberSelections(0), numberCollisions(0), hashTable(hashTable), hashTableMtx(hashTableMtx), nnCache(nnCache), searchSettings(searchSettings)
+{
+    inputPlanes = sharedNetBatch->get_input_planes(slotIdx);
+    valueOutputs = nullptr;
+    probOutputs = nullptr;
     searchLimits = nullptr;  // will be set by set_search_limits() every time before go()
 }
 
@@ -65,6 +71,31 @@ void SearchThread::set_is_running(bool value)
     isRunning = value;
 }
 
+size_t SearchThread::get_number_mini_batches() const
+{
+    return numberMiniBatches;
+}
+
+size_t SearchThread::get_number_evaluated_nodes() const
+{
+    return numberEvaluatedNodes;
+}
+
+size_t SearchThread::get_number_selections() const
+{
+    return numberSelections;
+}
+
+size_t SearchThread::get_number_collisions() const
+{
+    return numberCollisions;
+}
+
+chrono::steady_clock::time_point SearchThread::get_first_prediction_time() const
+{
+    return firstPredictionTime;
+}
+
 void SearchThread::stop()
 {
     isRunning = false;
@@ -87,7 +118,19 @@ bool is_transposition_verified(const unordered_map<Key,Node*>::const_iterator& i
             stateInfo->repetition == 0;
 }
 
-Node* get_new_child_to_evaluate(Node* rootNode, bool useTranspositionTable, unordered_map<Key, Node*>* hashTable, NodeDescription& description)
+bool probe_nn_cache(Node* node, NNCache* nnCache)
+{
+    float value;
+    DynamicVector<float> policyProbSmall;
+    if (nnCache->probe(node->get_pos(), node->get_number_child_nodes(), value, policyProbSmall)) {
+        node->set_nn_results(value, policyProbSmall);
+        return true;
+    }
+    return false;
+}
+
+template<Variant variant>
+Node* get_new_child_to_evaluate(Node* rootNode, bool useTranspositionTable, unordered_map<Key, Node*>* hashTable, mutex* hashTableMtx, NNCache* nnCache, NodeDescription& description)
 {
     Node *currentNode = rootNode;
     rootNode->apply_virtual_loss();
@@ -100,21 +143,45 @@ Node* get_new_child_to_evaluate(Node* rootNode, bool useTranspositionTable, unor
         currentNode->lock();
         if (!currentNode->is_expanded()) {
             currentNode->init_board();
-            unordered_map<Key, Node*>::const_iterator it = hashTable->find(currentNode->hash_key());
-            if(useTranspositionTable && it != hashTable->end() &&
-                    is_transposition_verified(it, currentNode->get_pos()->getStateInfo())) {
-                *currentNode = *it->second;  // call of assignment operator
+            if (currentNode->has_snapshot_record()) {
+                // the node is materialized from a loaded tree snapshot, its value is known unless it was pending for evaluation
+                currentNode->expand<variant>();
+                currentNode->restore_from_snapshot();
+                description.isCollision = false;
+                description.isTerminal = currentNode->is_terminal();
+                description.isTranposition = !description.isTerminal && currentNode->has_nn_results();
+                description.isCacheHit = false;
+                if (description.isTranposition) {
+                    lock_guard<mutex> lock(*hashTableMtx);
+                    hashTable->insert({currentNode->hash_key(), currentNode});
+                }
+                currentNode->unlock();
+                return currentNode;
+            }
+            bool isTransposition = false;
+            if (useTranspositionTable) {
+                // the lock also prevents that the found node is freed while it's copied
+                lock_guard<mutex> lock(*hashTableMtx);
+                unordered_map<Key, Node*>::const_iterator it = hashTable->find(currentNode->hash_key());
+                if (it != hashTable->end() && is_transposition_verified(it, currentNode->get_pos()->getStateInfo())) {
+                    *currentNode = *it->second;  // call of assignment operator
+                    isTransposition = true;
+                }
+            }
+            if (isTransposition) {
                 description.isCollision = false;
                 description.isTerminal = currentNode->is_terminal();
                 description.isTranposition = true;
+                description.isCacheHit = false;
                 currentNode->unlock();
                 return currentNode;
             }
             else {
-                currentNode->expand();
+                currentNode->expand<variant>();
                 description.isCollision = false;
                 description.isTerminal = currentNode->is_terminal();
                 description.isTranposition = false;
+                description.isCacheHit = !description.isTerminal && probe_nn_cache(currentNode, nnCache);
                 currentNode->unlock();
                 return currentNode;
             }
@@ -123,6 +190,7 @@ Node* get_new_child_to_evaluate(Node* rootNode, bool useTranspositionTable, unor
             description.isCollision = false;
             description.isTerminal = true;
             description.isTranposition = false;
+            description.isCacheHit = false;
             currentNode->unlock();
             return currentNode;
         }
@@ -130,6 +198,7 @@ Node* get_new_child_to_evaluate(Node* rootNode, bool useTranspositionTable, unor
             description.isCollision = true;
             description.isTerminal = false;
             description.isTranposition = false;
+            description.isCacheHit = false;
             currentNode->unlock();
             return currentNode;
         }
@@ -142,9 +211,10 @@ void SearchThread::set_nn_results_to_child_nodes()
     size_t batchIdx = 0;
     for (auto node: newNodes) {
         if (!node->is_terminal()) {
-            fill_nn_results(batchIdx, netBatch->is_policy_map(), searchSettings, valueOutputs, probOutputs, node);
+            fill_nn_results(batchIdx, isPolicyMap, searchSettings, valueOutputs, probOutputs, node, nnCache, policyProbSmall);
         }
         ++batchIdx;
+        lock_guard<mutex> lock(*hashTableMtx);
         hashTable->insert({node->get_pos()->hash_key(), node});
     }
 }
@@ -169,6 +239,7 @@ bool SearchThread::nodes_limits_ok()
     return searchLimits->nodes == 0 || (rootNode->get_visits() < searchLimits->nodes);
 }
 
+template<Variant variant>
 void SearchThread::create_mini_batch()
 {
     // select nodes to add to the mini-batch
@@ -179,9 +250,11 @@ void SearchThread::create_mini_batch()
            collisionNodes.size() < searchSettings->batchSize &&
            transpositionNodes.size() < searchSettings->batchSize &&
            terminalNodes.size() < searchSettings->batchSize) {
-        currentNode = get_new_child_to_evaluate(rootNode, searchSettings->useTranspositionTable, hashTable, description);
+        currentNode = get_new_child_to_evaluate<variant>(rootNode, searchSettings->useTranspositionTable, hashTable, hashTableMtx, nnCache, description);
+        ++numberSelections;
 
-        if (description.isTranposition) {
+        if (description.isTranposition || description.isCacheHit) {
+            // the value is already known and can be backpropagated without requesting the NN
             transpositionNodes.push_back(currentNode);
         }
         else if(description.isTerminal) {
@@ -191,18 +264,20 @@ void SearchThread::create_mini_batch()
         else if (description.isCollision) {
             // store a pointer to the collision node in order to revert the virtual loss of the forward propagation
             collisionNodes.push_back(currentNode);
+            ++numberCollisions;
         }
         else {
-            prepare_node_for_nn(currentNode, newNodes, inputPlanes);
+            prepare_node_for_nn<variant>(currentNode, newNodes, inputPlanes);
         }
     }
 }
 
+template<Variant variant>
 void SearchThread::thread_iteration()
 {
-    create_mini_batch();
+    create_mini_batch<variant>();
     if (newNodes.size() != 0) {
-        netBatch->predict(inputPlanes, *valueOutputs, *probOutputs);
+        predict_mini_batch();
         set_nn_results_to_child_nodes();
     }
     //    cout << "backup values" << endl;
@@ -211,12 +286,42 @@ void SearchThread::thread_iteration()
     //    rootNode->numberVisits = sum(rootNode->childNumberVisits);
 }
 
+void SearchThread::predict_mini_batch()
+{
+    ++numberMiniBatches;
+    numberEvaluatedNodes += newNodes.size();
+    if (sharedNetBatch != nullptr) {
+        sharedNetBatch->predict(slotIdx, newNodes.size(), valueOutputs, probOutputs);
+    }
+    else {
+        netBatch->predict(newNodes.size(), valueOutputs, probOutputs);
+    }
+    if (firstPredictionTime == chrono::steady_clock::time_point()) {
+        firstPredictionTime = chrono::steady_clock::now();
+    }
+}
+
+template<Variant variant>
+void SearchThread::run()
+{
+    firstPredictionTime = chrono::steady_clock::time_point();
+    if (sharedNetBatch != nullptr) {
+        sharedNetBatch->activate_slot(slotIdx);
+    }
+    do {
+        thread_iteration<variant>();
+    } while(isRunning && nodes_limits_ok());
+    if (sharedNetBatch != nullptr) {
+        sharedNetBatch->deactivate_slot(slotIdx);
+    }
+}
+
 void go(SearchThread *t)
 {
     t->set_is_running(true);
-    do {
-        t->thread_iteration();
-    } while(t->get_is_running() && t->nodes_limits_ok());
+    // the variant is resolved once here instead of within every rollout
+    dispatch_variant(t->get_root_node()->get_pos()->variant(), *t);
+    t->set_is_running(false);
 }
 
 void backup_values(vector<Node*>& nodes)
@@ -227,29 +332,31 @@ void backup_values(vector<Node*>& nodes)
     nodes.clear();
 }
 
+template<Variant variant>
 void prepare_node_for_nn(Node* newNode, vector<Node*>& newNodes, float* inputPlanes)
 {
     // fill a new board in the input_planes vector
     // we shift the index by NB_VALUES_TOTAL each time
-    board_to_planes(newNode->get_pos(), newNode->get_pos()->getStateInfo()->repetition, true, inputPlanes+newNodes.size()*NB_VALUES_TOTAL);
+    float* nodePlanes = inputPlanes+newNodes.size()*NB_VALUES_TOTAL;
+    const int repetition = newNode->get_pos()->getStateInfo()->repetition;
+    if (newNodes.size() != 0) {
+        // derive the planes from the previous node of the batch, which is often a sibling that differs only by a single move
+        board_to_planes_incremental<variant>(newNodes.back()->get_pos(), nodePlanes-NB_VALUES_TOTAL, newNode->get_pos(), repetition, true, nodePlanes);
+    }
+    else {
+        board_to_planes<variant>(newNode->get_pos(), repetition, true, nodePlanes);
+    }
 
     // save a reference newly created list in the temporary list for node creation
     // it will later be updated with the evaluation of the NN
     newNodes.push_back(newNode);
 }
 
-void fill_nn_results(size_t batchIdx, bool is_policy_map, const SearchSettings* searchSettings, NDArray* valueOutputs, NDArray* probOutputs, Node *node)
+void fill_nn_results(size_t batchIdx, bool is_policy_map, const SearchSettings* searchSettings, const float* valueOutputs, const float* probOutputs, Node *node, NNCache* nnCache, DynamicVector<float>& policyProbSmall)
 {
-    vector<Move> legalMoves = retrieve_legal_moves(node->get_child_nodes());
-    assert(legalMoves.size() == node->get_number_child_nodes());
-    DynamicVector<float> policyProbSmall(legalMoves.size());
-    get_probs_of_moves(get_policy_data_batch(batchIdx, probOutputs, is_policy_map),
-                       legalMoves,
-                       get_current_move_lookup(node->side_to_move()),
-                       policyProbSmall);
-    if (!is_policy_map) {
-        apply_softmax(policyProbSmall);
-    }
-    enhance_moves(searchSettings, node->get_pos(), legalMoves, policyProbSmall);
-    node->set_nn_results(valueOutputs->At(batchIdx, 0), policyProbSmall);
+    set_policy_from_nn_output(node, get_policy_data_batch(batchIdx, probOutputs, is_policy_map),
+                              get_current_move_lookup(node->side_to_move()), !is_policy_map,
+                              searchSettings, policyProbSmall);
+    nnCache->store(node->get_pos(), valueOutputs[batchIdx], policyProbSmall);
+    node->set_nn_results(valueOutputs[batchIdx], policyProbSmall);
 }
@@ -28,18 +28,28 @@
 #ifndef SEARCHTHREAD_H
 #define SEARCHTHREAD_H
 
+#include <chrono>
+#include <atomic>
 #include "node.h"
 #include "constants.h"
 #include "neuralnetapi.h"
+#include "sharednetbatch.h"
+#include "nncache.h"
 #include "config/searchlimits.h"
+#include "domain/variants.h"
 
 class SearchThread
 {
 private:
     Node* rootNode;
     NeuralNetAPI* netBatch;
+    // network which is shared with the search threads of other games, netBatch is unused if it is set
+    SharedNetBatch* sharedNetBatch;
+    size_t slotIdx;
+    bool isPolicyMap;
 
     // inputPlanes stores the plane representation of all newly expanded nodes of a single mini-batch
+    // the memory is owned by the network
     float* inputPlanes;
 
     // list of all node objects which have been selected for expansion
@@ -48,14 +58,28 @@ private:
     vector<Node*> collisionNodes;
     vector<Node*> terminalNodes;
 
-    // stores the corresponding value-Outputs and probability-Outputs of the nodes stored in the vector "newNodes"
-    // sufficient memory according to the batch-size will be allocated in the constructor
-    NDArray* valueOutputs;
-    NDArray* probOutputs;
-
-    bool isRunning;
+    // read-only views on the value-Outputs and probability-Outputs of the nodes stored in the vector "newNodes"
+    // the memory is owned by the network and is valid until its next prediction
+    const float* valueOutputs;
+    const float* probOutputs;
+    // reusable buffer for the post-processed policy of a single node
+    DynamicVector<float> policyProbSmall;
+
+    // polled by the agent while the search is running
+    atomic<bool> isRunning;
+    // number of mini-batches which were sent to the neural network and the number of positions which they contained
+    size_t numberMiniBatches;
+    size_t numberEvaluatedNodes;
+    // number of selected leaf nodes and how many of them were already selected by another rollout
+    size_t numberSelections;
+    size_t numberCollisions;
+    // time at which the first prediction of the current run returned, the default value if there hasn't been any yet
+    chrono::steady_clock::time_point firstPredictionTime;
 
     unordered_map<Key, Node*> *hashTable;
+    // lock for the hash table which is shared with all other search threads and the subtree reclaimer
+    mutex* hashTableMtx;
+    NNCache* nnCache;
     SearchSettings* searchSettings;
     SearchLimits* searchLimits;
 
@@ -74,14 +98,32 @@ private:
      */
     void backup_collisions();
 
+    /**
+     * @brief predict_mini_batch Requests the neural network for all newly expanded nodes
+     */
+    inline void predict_mini_batch();
+
 public:
     /**
      * @brief SearchThread
      * @param netBatch Network API object which provides the prediction of the neural network
      * @param searchSettings Given settings for this search run
      * @param hashTable Handle to the hash table
+     * @param hashTableMtx Lock which protects the hash table
+     * @param nnCache Handle to the neural network cache
+     */
+    SearchThread(NeuralNetAPI* netBatch, SearchSettings* searchSettings, unordered_map<Key, Node*>* hashTable, mutex* hashTableMtx, NNCache* nnCache);
+
+    /**
+     * @brief SearchThread Constructor for a search thread which evaluates its mini-batches together with the search threads of other games
+     * @param sharedNetBatch Shared network
+     * @param slotIdx Slot of the shared network which belongs to this thread
+     * @param searchSettings Given settings for this search run
+     * @param hashTable Handle to the hash table
+     * @param hashTableMtx Lock which protects the hash table
+     * @param nnCache Handle to the neural network cache
      */
-    SearchThread(NeuralNetAPI* netBatch, SearchSettings* searchSettings, unordered_map<Key, Node*>* hashTable);
+    SearchThread(SharedNetBatch* sharedNetBatch, size_t slotIdx, SearchSettings* searchSettings, unordered_map<Key, Node*>* hashTable, mutex* hashTableMtx, NNCache* nnCache);
 
     /**
      * @brief create_mini_batch Creates a mini-batch of new unexplored nodes.
@@ -89,13 +131,22 @@ public:
      * If the node was found in the hash-table it's value is backpropagated without requesting the NN.
      * If a collision occurs (the same node was selected multiple times), it will be added to the collisionNodes vector
      */
+    template<Variant variant>
     void create_mini_batch();
 
     /**
      * @brief thread_iteration Runs multiple mcts-rollouts as long as a new batch is filled
      */
+    template<Variant variant>
     void thread_iteration();
 
+    /**
+     * @brief run Runs thread iterations until the thread is stopped or the node limit is reached.
+     * The search loop is specialized for the variant of the root position which is selected once by go().
+     */
+    template<Variant variant>
+    void run();
+
     /**
      * @brief nodes_limits_ok Checks if the searchLimits based on the amount of nodes to search has been reached.
      * In the case the number of nodes is set to zero the limit condition is ignored
@@ -115,8 +166,17 @@ public:
     void set_root_node(Node *value);
     bool get_is_running() const;
     void set_is_running(bool value);
+    size_t get_number_mini_batches() const;
+    size_t get_number_evaluated_nodes() const;
+    size_t get_number_selections() const;
+    size_t get_number_collisions() const;
+    chrono::steady_clock::time_point get_first_prediction_time() const;
 };
 
+/**
+ * @brief go Starts the search of the given thread for the variant of its root node
+ * @param t Search thread
+ */
 void go(SearchThread *t);
 
 struct NodeDescription
@@ -127,6 +187,8 @@ struct NodeDescription
     bool isTerminal;
     // flag signaling a transposition state
     bool isTranposition;
+    // flag signaling that the neural network results were taken from the nn cache
+    bool isCacheHit;
     // depth which was reached on this rollout
     size_t depth;
 };
@@ -136,13 +198,24 @@ struct NodeDescription
  * @param rootNode Root node where all simulations start
  * @param useTranspositionTable Flag if the transposition table shall be used
  * @param hashTable Pointer to the hashTable
+ * @param hashTableMtx Lock which protects the hash table
+ * @param nnCache Pointer to the neural network cache which is consulted for newly expanded nodes
  * @param description Output struct which holds information what type of node it is
- * @return Pointer to next child to evaluate (can also be terminal or tranposition node in which case no NN eval is required)
+ * @return Pointer to next child to evaluate (can also be terminal, tranposition or cached node in which case no NN eval is required)
  */
-Node* get_new_child_to_evaluate(Node* rootNode, bool useTranspositionTable, unordered_map<Key, Node*>* hashTable, NodeDescription& description);
+template<Variant variant>
+Node* get_new_child_to_evaluate(Node* rootNode, bool useTranspositionTable, unordered_map<Key, Node*>* hashTable, mutex* hashTableMtx, NNCache* nnCache, NodeDescription& description);
 
 void backup_values(vector<Node*>& nodes);
 
+/**
+ * @brief probe_nn_cache Sets the neural network results of a newly expanded node if its position is stored in the nn cache
+ * @param node Expanded node without neural network results
+ * @param nnCache Pointer to the neural network cache
+ * @return True on a cache hit
+ */
+bool probe_nn_cache(Node* node, NNCache* nnCache);
+
 /**
  * @brief create_new_node Creates a new node which will be added to the tree
  * @param newPos Board position which belongs to the node
@@ -150,8 +223,20 @@ void backup_values(vector<Node*>& nodes);
  * @param childIdx Index on how to visit the child node from its parent
  * @param numberNewNodes Index of the new node in the current batch
  */
+template<Variant variant>
 inline void prepare_node_for_nn(Node* newNode, vector<Node*>& newNodes, float* inputPlanes);
 
-void fill_nn_results(size_t batchIdx, bool is_policy_map, const SearchSettings* searchSettings, NDArray* valueOutputs, NDArray* probOutputs, Node *node);
+/**
+ * @brief fill_nn_results Assigns the value and the policy of the legal moves from the raw network outputs to the given node
+ * @param batchIdx Index of the node in the batch
+ * @param is_policy_map Sets if the policy is encoded in policy map representation
+ * @param searchSettings Settings which are used for move enhancement
+ * @param valueOutputs Value predictions of the batch
+ * @param probOutputs Raw policy predictions of the batch
+ * @param node Node which receives the results
+ * @param nnCache Neural network cache in which the results are stored
+ * @param policyProbSmall Reusable buffer for the policy of the legal moves
+ */
+void fill_nn_results(size_t batchIdx, bool is_policy_map, const SearchSettings* searchSettings, const float* valueOutputs, const float* probOutputs, Node *node, NNCache* nnCache, DynamicVector<float>& policyProbSmall);
 
 #endif // SEARCHTHREAD_H
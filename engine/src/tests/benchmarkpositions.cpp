@@ -24,6 +24,9 @@
  */
 
 #include "benchmarkpositions.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
 #include "uci.h"
 
 BenchmarkPositions::BenchmarkPositions()
@@ -49,3 +52,46 @@ BenchmarkPositions::BenchmarkPositions()
     };
 }
 
+bool BenchmarkPositions::load_epd(const string& fileName)
+{
+    ifstream epdFile(fileName);
+    if (!epdFile.is_open()) {
+        cout << "info string failed to open " << fileName << endl;
+        return false;
+    }
+    vector<TestPosition> epdPositions;
+    string line;
+    while (getline(epdFile, line)) {
+        istringstream is(line);
+        string fen;
+        string field;
+        for (size_t fieldIdx = 0; fieldIdx < 4 && is >> field; ++fieldIdx) {
+            fen += (fieldIdx == 0 ? "" : " ") + field;
+        }
+        if (count(fen.begin(), fen.end(), ' ') < 3) {
+            continue;
+        }
+        string blunderMove;
+        string alternativeMove;
+        // the operations are separated by semicolons, e.g. "am h4h5; bm Q@h2; id "pos1";"
+        string operation;
+        while (getline(is, operation, ';')) {
+            istringstream isOperation(operation);
+            string opcode;
+            isOperation >> opcode;
+            if (opcode == "am") {
+                isOperation >> blunderMove;
+            }
+            else if (opcode == "bm") {
+                isOperation >> alternativeMove;
+            }
+        }
+        epdPositions.push_back(TestPosition(fen + " 0 1", blunderMove, alternativeMove));
+    }
+    if (epdPositions.empty()) {
+        cout << "info string " << fileName << " doesn't contain any positions" << endl;
+        return false;
+    }
+    positions = epdPositions;
+    return true;
+}
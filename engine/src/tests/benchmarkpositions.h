@@ -51,6 +51,14 @@ public:
     float totalNPS;
     float totalDepth;
     BenchmarkPositions();
+
+    /**
+     * @brief load_epd Replaces the positions by the ones of an EPD file.
+     * The operations "am" (avoid move) and "bm" (best move) are used as blunder and alternative move in UCI notation.
+     * @param fileName EPD file
+     * @return True, if at least one position was loaded
+     */
+    bool load_epd(const string& fileName);
 };
 
 #ifdef BENCHMARK
@@ -0,0 +1,148 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: benchmarkreport.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#include "benchmarkreport.h"
+#include <iostream>
+#include <iomanip>
+
+using json = nlohmann::json;
+
+namespace {
+struct SummaryMetric {
+    string name;
+    bool isHigherBetter;
+    bool isGated;
+};
+
+// summary entries which are compared against the baseline
+const vector<SummaryMetric> SUMMARY_METRICS = {
+    {"nps", true, true},
+    {"nodes", true, false},
+    {"depth", true, false},
+    {"tree_memory", false, false},
+    {"batch_fill", true, false},
+    {"collision_ratio", false, false},
+    {"time_to_first_batch_ms", false, false},
+};
+}  // namespace
+
+bool PositionBenchmark::is_passed() const
+{
+    return blunderMove.empty() || bestMove != blunderMove;
+}
+
+json create_benchmark_report(const vector<PositionBenchmark>& results, const json& settings)
+{
+    json report;
+    report["settings"] = settings;
+    report["positions"] = json::array();
+
+    size_t passed = 0;
+    double totalNodes = 0;
+    double totalNPS = 0;
+    double totalDepth = 0;
+    double totalTreeMemory = 0;
+    double totalBatchFill = 0;
+    double totalCollisionRatio = 0;
+    double totalTimeToFirstBatch = 0;
+    size_t numberFirstBatches = 0;
+    for (const PositionBenchmark& result : results) {
+        json position;
+        position["fen"] = result.fen;
+        position["best_move"] = result.bestMove;
+        position["blunder_move"] = result.blunderMove;
+        position["passed"] = result.is_passed();
+        position["nodes"] = result.nodes;
+        position["nps"] = result.nps;
+        position["depth"] = result.depth;
+        position["time_ms"] = result.elapsedTimeMS;
+        position["tree_memory"] = result.treeMemory;
+        position["batch_fill"] = result.batchFill;
+        position["collision_ratio"] = result.collisionRatio;
+        position["time_to_first_batch_ms"] = result.timeToFirstBatchMS;
+        report["positions"].push_back(position);
+
+        passed += result.is_passed();
+        totalNodes += result.nodes;
+        totalNPS += result.nps;
+        totalDepth += result.depth;
+        totalTreeMemory += result.treeMemory;
+        totalBatchFill += result.batchFill;
+        totalCollisionRatio += result.collisionRatio;
+        if (result.timeToFirstBatchMS >= 0) {
+            totalTimeToFirstBatch += result.timeToFirstBatchMS;
+            ++numberFirstBatches;
+        }
+    }
+
+    const double numberPositions = max(results.size(), size_t(1));
+    json summary;
+    summary["number_positions"] = results.size();
+    summary["passed"] = passed;
+    summary["nodes"] = totalNodes / numberPositions;
+    summary["nps"] = totalNPS / numberPositions;
+    summary["depth"] = totalDepth / numberPositions;
+    summary["tree_memory"] = totalTreeMemory / numberPositions;
+    summary["batch_fill"] = totalBatchFill / numberPositions;
+    summary["collision_ratio"] = totalCollisionRatio / numberPositions;
+    summary["time_to_first_batch_ms"] = numberFirstBatches == 0 ? -1.0 : totalTimeToFirstBatch / numberFirstBatches;
+    report["summary"] = summary;
+    return report;
+}
+
+bool compare_to_baseline(const json& report, const json& baseline, float threshold)
+{
+    if (!baseline.contains("summary") || !baseline.contains("settings")) {
+        cout << "info string the baseline isn't a benchmark report" << endl;
+        return false;
+    }
+    if (baseline["settings"] != report["settings"]) {
+        cout << "info string warning: the baseline was measured with different settings " << baseline["settings"].dump() << endl;
+    }
+
+    bool isRegression = false;
+    cout << endl << "Baseline comparison" << endl;
+    cout << "----------------------" << endl;
+    for (const SummaryMetric& metric : SUMMARY_METRICS) {
+        if (!baseline["summary"].contains(metric.name) || !report["summary"].contains(metric.name)) {
+            continue;
+        }
+        const double baselineValue = baseline["summary"][metric.name].get<double>();
+        const double value = report["summary"][metric.name].get<double>();
+        if (baselineValue <= 0) {
+            cout << left << setw(24) << metric.name << value << " (no baseline)" << endl;
+            continue;
+        }
+        const double change = (value - baselineValue) / baselineValue * 100;
+        const double loss = metric.isHigherBetter ? -change : change;
+        const bool isMetricRegression = metric.isGated && loss > threshold;
+        isRegression |= isMetricRegression;
+        cout << left << setw(24) << metric.name << baselineValue << " -> " << value << " (" << showpos << fixed << setprecision(2)
+             << change << noshowpos << defaultfloat << setprecision(6) << "%)" << (isMetricRegression ? " REGRESSION" : "") << endl;
+    }
+    cout << right << (isRegression ? "Regression beyond " : "No regression beyond ") << threshold << "%" << endl;
+    return !isRegression;
+}
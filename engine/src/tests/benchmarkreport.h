@@ -0,0 +1,83 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: benchmarkreport.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Structured results of the benchmark command. The per-position measurements are summarized in a json report
+ * which can be stored as a baseline and compared with the report of a later build.
+ */
+
+#ifndef BENCHMARKREPORT_H
+#define BENCHMARKREPORT_H
+
+#include <string>
+#include <vector>
+#include "nlohmann/json.hpp"
+
+using namespace std;
+
+// default maximum relative NPS loss in percent which isn't treated as a regression
+const float BENCHMARK_DEFAULT_THRESHOLD = 5.0f;
+
+struct PositionBenchmark
+{
+    string fen;
+    string bestMove;
+    // move which must not be played, empty if the position only measures the performance
+    string blunderMove;
+    size_t nodes;
+    float nps;
+    size_t depth;
+    float elapsedTimeMS;
+    // estimated memory of the search tree after the search in bytes
+    size_t treeMemory;
+    // evaluated positions divided by the capacity of the sent mini-batches
+    float batchFill;
+    // fraction of the selected leaf nodes which collided with a node that was already waiting for its evaluation
+    float collisionRatio;
+    // time from the start of the search threads until the first mini-batch was evaluated, -1 if there wasn't any
+    double timeToFirstBatchMS;
+
+    bool is_passed() const;
+};
+
+/**
+ * @brief create_benchmark_report Creates the json report of a benchmark run which contains the settings,
+ * the measurements of every position and their averages in the entry "summary"
+ * @param results Measurements of all positions
+ * @param settings Settings of the run which must be the same for the baseline comparison, e.g. threads and batch size
+ * @return Report
+ */
+nlohmann::json create_benchmark_report(const vector<PositionBenchmark>& results, const nlohmann::json& settings);
+
+/**
+ * @brief compare_to_baseline Prints the relative change of the summary metrics compared to a previous report.
+ * Only a loss of the average NPS is treated as a regression, because the other metrics depend more on the positions.
+ * @param report Current report
+ * @param baseline Report of the baseline build
+ * @param threshold Maximum relative NPS loss in percent which is still accepted
+ * @return True, if there isn't any regression
+ */
+bool compare_to_baseline(const nlohmann::json& report, const nlohmann::json& baseline, float threshold);
+
+#endif // BENCHMARKREPORT_H
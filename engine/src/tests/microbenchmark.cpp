@@ -0,0 +1,181 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: microbenchmark.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ */
+
+#ifdef BUILD_BENCHMARKS
+#include "microbenchmark.h"
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include "movegen.h"
+#include "benchmarkpositions.h"
+#include "../rl/match.h"
+
+namespace {
+atomic<size_t> numberAllocations(0);
+}  // namespace
+
+// the global allocation functions are replaced to count the heap allocations of the measured primitives
+void* operator new(size_t size)
+{
+    numberAllocations.fetch_add(1, memory_order_relaxed);
+    if (void* ptr = malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+const vector<pair<Variant, string>> BENCHMARK_VARIANTS = {
+    {CHESS_VARIANT, "chess"},
+#ifdef CRAZYHOUSE
+    {CRAZYHOUSE_VARIANT, "crazyhouse"},
+#endif
+#ifndef CRAZYHOUSE_ONLY
+#ifdef KOTH
+    {KOTH_VARIANT, "kingofthehill"},
+#endif
+#ifdef THREECHECK
+    {THREECHECK_VARIANT, "3check"},
+#endif
+#ifdef ANTI
+    {ANTI_VARIANT, "giveaway"},
+#endif
+#ifdef ATOMIC
+    {ATOMIC_VARIANT, "atomic"},
+#endif
+#ifdef HORDE
+    {HORDE_VARIANT, "horde"},
+#endif
+#ifdef RACE
+    {RACE_VARIANT, "racingkings"},
+#endif
+#endif
+};
+
+size_t get_number_allocations()
+{
+    return numberAllocations.load(memory_order_relaxed);
+}
+
+void print_result(const string& variantName, const string& primitive, const MicrobenchmarkResult& result)
+{
+    cout << left << setw(16) << variantName << setw(34) << primitive << right << fixed
+         << setw(12) << setprecision(1) << result.nsPerOp << " ns/op"
+         << setw(10) << setprecision(2) << result.allocationsPerOp << " allocs/op" << defaultfloat << endl;
+}
+
+Board* copy_position(const Board& pos)
+{
+    Board* newPos = new Board(pos);
+    newPos->setStateInfo(new StateInfo(*pos.getStateInfo()));
+    return newPos;
+}
+
+void collect_positions(Variant variant, Thread* thread, deque<StateInfo>& states, deque<Board>& positions)
+{
+    mt19937 generator(42);
+    const size_t nbGames = 20;
+    const size_t maxPlies = 80;
+    float value;
+    for (size_t gameIdx = 0; gameIdx < nbGames; ++gameIdx) {
+        Board pos;
+        states.emplace_back();
+        pos.set(StartFENs[variant], false, variant, &states.back(), thread);
+        for (size_t ply = 0; ply < maxPlies; ++ply) {
+            const MoveList<LEGAL> moveList(pos);
+            states.emplace_back();
+            pos.do_move(moveList.begin()[generator() % moveList.size()], states.back());
+            // expanding a terminal position would access the parent node, which the benchmark nodes don't have
+            if (is_terminal_position(pos, value)) {
+                break;
+            }
+            // the copy gets its own state info, its history still refers to the stored states
+            positions.emplace_back(pos);
+            positions.back().setStateInfo(new StateInfo(*pos.getStateInfo()));
+        }
+        // the state infos of the game belong to the storage
+        pos.setStateInfo(nullptr);
+    }
+#ifdef CRAZYHOUSE
+    if (variant == CRAZYHOUSE_VARIANT) {
+        BenchmarkPositions benchmark;
+        for (const TestPosition& testPos : benchmark.positions) {
+            positions.emplace_back();
+            positions.back().set(testPos.fen, false, variant, new StateInfo, thread);
+            if (is_terminal_position(positions.back(), value)) {
+                positions.pop_back();
+            }
+        }
+    }
+#endif
+}
+
+int main() {
+    Bitboards::init();
+    Position::init();
+    Bitbases::init();
+    auto uiThread = make_shared<Thread>(0);
+
+    float checksum = 0;
+    for (const pair<Variant, string>& variant : BENCHMARK_VARIANTS) {
+        deque<StateInfo> states;
+        deque<Board> positions;
+        collect_positions(variant.first, uiThread.get(), states, positions);
+        cout << "variant " << variant.second << " positions " << positions.size() << endl;
+        run_planes_benchmarks(variant.second, positions, checksum);
+        run_search_benchmarks(variant.second, positions, checksum);
+    }
+    cout << "checksum " << checksum << endl;
+}
+#endif
@@ -0,0 +1,143 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: microbenchmark.h
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Harness of the microbenchmark executable which measures single primitives of the input encoding and the search
+ * in isolation. Every primitive is reported in nanoseconds and heap allocations per operation for every variant.
+ * The executable is built by enabling the CMake option BUILD_BENCHMARKS.
+ */
+
+#ifndef MICROBENCHMARK_H
+#define MICROBENCHMARK_H
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+#include "thread.h"
+#include "../board.h"
+#include "../domain/variants.h"
+
+using namespace std;
+
+// minimum run time for each measurement
+const chrono::milliseconds MIN_RUN_TIME(500);
+
+// all variants which are encoded by the input representation
+extern const vector<pair<Variant, string>> BENCHMARK_VARIANTS;
+
+struct MicrobenchmarkResult
+{
+    double nsPerOp;
+    // calls of operator new per operation, aligned allocations of blaze vectors aren't included
+    double allocationsPerOp;
+    size_t numberOps;
+};
+
+/**
+ * @brief get_number_allocations Returns the number of calls of the global operator new since the program start
+ */
+size_t get_number_allocations();
+
+/**
+ * @brief measure Repeats the given operation until MIN_RUN_TIME has passed. Only the operation itself is timed.
+ * @param setup Prepares a round of operations and returns the number of calls of the operation in this round
+ * @param operation Performs the operation with the given call index of the round and returns the number of operations it did
+ * @param teardown Cleans up after a round
+ * @return Average time and allocations per operation
+ */
+template<typename Setup, typename Operation, typename Teardown>
+MicrobenchmarkResult measure(Setup setup, Operation operation, Teardown teardown)
+{
+    size_t numberOps = 0;
+    size_t numberAllocations = 0;
+    chrono::steady_clock::duration elapsed = chrono::steady_clock::duration::zero();
+    while (elapsed < MIN_RUN_TIME) {
+        const size_t numberCalls = setup();
+        if (numberCalls == 0) {
+            teardown();
+            break;
+        }
+        const size_t allocationsPre = get_number_allocations();
+        const auto start = chrono::steady_clock::now();
+        for (size_t callIdx = 0; callIdx < numberCalls; ++callIdx) {
+            numberOps += operation(callIdx);
+        }
+        elapsed += chrono::steady_clock::now() - start;
+        numberAllocations += get_number_allocations() - allocationsPre;
+        teardown();
+    }
+    if (numberOps == 0) {
+        return {0, 0, 0};
+    }
+    return {double(chrono::duration_cast<chrono::nanoseconds>(elapsed).count()) / numberOps,
+            double(numberAllocations) / numberOps, numberOps};
+}
+
+/**
+ * @brief print_result Prints a single measurement as a line of the result table
+ * @param variantName Name of the variant
+ * @param primitive Name of the measured primitive
+ * @param result Measurement
+ */
+void print_result(const string& variantName, const string& primitive, const MicrobenchmarkResult& result);
+
+/**
+ * @brief copy_position Returns a heap copy of the position with its own copy of the current state info,
+ * so that it can be owned by a node
+ * @param pos Position
+ * @return New board
+ */
+Board* copy_position(const Board& pos);
+
+/**
+ * @brief collect_positions Collects the positions of random games for the given variant.
+ * For crazyhouse the positions of BenchmarkPositions are added as well. Terminal positions are skipped.
+ * Every collected position owns a copy of its current state info.
+ * @param variant Variant
+ * @param thread Thread which is assigned to the positions
+ * @param states Storage for the state infos of the played moves, which must stay valid as long as the positions are used
+ * @param positions Output positions
+ */
+void collect_positions(Variant variant, Thread* thread, deque<StateInfo>& states, deque<Board>& positions);
+
+/**
+ * @brief run_planes_benchmarks Measures board_to_planes() and board_to_planes_incremental()
+ * @param variantName Name of the variant
+ * @param positions Positions of a single variant, each with its own state info as provided by collect_positions().
+ * Nothing is measured for less than two positions.
+ * @param checksum Accumulated results which prevent the compiler from removing the measured calls
+ */
+void run_planes_benchmarks(const string& variantName, const deque<Board>& positions, float& checksum);
+
+/**
+ * @brief run_search_benchmarks Measures the search primitives on the given positions and on synthetic search trees
+ * which are grown from them with random network evaluations
+ * @param variantName Name of the variant
+ * @param positions Positions of a single variant
+ * @param checksum Accumulated results which prevent the compiler from removing the measured calls
+ */
+void run_search_benchmarks(const string& variantName, const deque<Board>& positions, float& checksum);
+
+#endif // MICROBENCHMARK_H
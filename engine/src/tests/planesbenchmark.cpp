@@ -0,0 +1,64 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+ * @file: planesbenchmark.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Microbenchmark of the input plane encoding.
+ * It reports the time per position of board_to_planes() and board_to_planes_incremental().
+ */
+
+#ifdef BUILD_BENCHMARKS
+#include "microbenchmark.h"
+#include "../domain/crazyhouse/constants.h"
+#include "../domain/crazyhouse/inputrepresentation.h"
+
+void run_planes_benchmarks(const string& variantName, const deque<Board>& positions, float& checksum)
+{
+    // the incremental encoding needs a previous position
+    if (positions.size() < 2) {
+        return;
+    }
+    vector<float> inputPlanes(NB_VALUES_TOTAL);
+    const auto setup = [&]() {
+        board_to_planes(&positions.front(), 0, true, inputPlanes.data());
+        return positions.size() - 1;
+    };
+    const auto teardown = [&]() {
+        checksum += inputPlanes[0];
+    };
+
+    const MicrobenchmarkResult full = measure(setup, [&](size_t idx) {
+        board_to_planes(&positions[idx+1], 0, true, inputPlanes.data());
+        checksum += inputPlanes[idx % NB_VALUES_TOTAL];
+        return 1;
+    }, teardown);
+    print_result(variantName, "board_to_planes", full);
+
+    // every position is derived from the encoding of the previous position
+    const MicrobenchmarkResult incremental = measure(setup, [&](size_t idx) {
+        board_to_planes_incremental(&positions[idx], inputPlanes.data(), &positions[idx+1], 0, true, inputPlanes.data());
+        checksum += inputPlanes[idx % NB_VALUES_TOTAL];
+        return 1;
+    }, teardown);
+    print_result(variantName, "board_to_planes_incremental", incremental);
+}
+#endif
@@ -0,0 +1,227 @@
+/*
+  CrazyAra, a deep learning chess variant engine
+  Copyright (C) 2018  Johannes Czech, Moritz Willig, Alena Beyer
+  Copyright (C) 2019  Johannes Czech
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * @file: searchbenchmark.cpp
+ * Created on 18.10.2026
+ * @author: queensgambit
+ *
+ * Microbenchmark of the search primitives. The selection and the backup are measured on synthetic search trees which
+ * are grown like by a single search thread, but with random network evaluations instead of a neural network.
+ */
+
+#ifdef BUILD_BENCHMARKS
+#include "microbenchmark.h"
+#include <cmath>
+#include <random>
+#include <unordered_map>
+#include "movegen.h"
+#include "../node.h"
+#include "../searchthread.h"
+#include "../nn/nncache.h"
+#include "../domain/crazyhouse/constants.h"
+
+namespace {
+// number of positions which are used as roots of the synthetic search trees
+const size_t NB_TREES = 16;
+// number of rollouts which grow each synthetic search tree
+const size_t NB_TREE_ROLLOUTS = 800;
+// batch size of the synthetic network outputs
+const size_t NB_BATCH_OUTPUTS = 16;
+
+/**
+ * @brief random_policy Returns a random prior policy with a few dominant moves, similar to the output of a trained network
+ * @param numberMoves Number of legal moves
+ * @param generator Random generator
+ * @return Normalized policy
+ */
+DynamicVector<float> random_policy(size_t numberMoves, mt19937& generator)
+{
+    gamma_distribution<float> distribution(0.3f, 1.0f);
+    DynamicVector<float> policy(numberMoves);
+    float sum = 0;
+    for (size_t idx = 0; idx < numberMoves; ++idx) {
+        policy[idx] = distribution(generator) + 1e-6f;
+        sum += policy[idx];
+    }
+    policy /= sum;
+    return policy;
+}
+
+/**
+ * @brief grow_tree Creates a search tree for the given position by running rollouts with virtual loss, expansion and backup
+ * @param pos Root position
+ * @param searchSettings Search settings of the nodes
+ * @param generator Random generator for the network evaluations
+ * @param evaluatedNodes Output vector which receives all non-terminal expanded nodes including the root
+ * @return Root node of the tree
+ */
+Node* grow_tree(const Board& pos, SearchSettings* searchSettings, mt19937& generator, vector<Node*>& evaluatedNodes)
+{
+    uniform_real_distribution<float> valueDistribution(-1.0f, 1.0f);
+    Node* rootNode = new Node(copy_position(pos), nullptr, MOVE_NONE, searchSettings);
+    rootNode->expand();
+    if (rootNode->is_terminal()) {
+        return rootNode;
+    }
+    rootNode->set_nn_results(valueDistribution(generator), random_policy(rootNode->get_number_child_nodes(), generator));
+    evaluatedNodes.push_back(rootNode);
+
+    for (size_t rollout = 0; rollout < NB_TREE_ROLLOUTS; ++rollout) {
+        Node* node = rootNode;
+        node->apply_virtual_loss();
+        while (node->is_expanded() && !node->is_terminal()) {
+            node = select_child_node(node);
+            node->apply_virtual_loss();
+        }
+        if (!node->is_expanded()) {
+            node->init_board();
+            node->expand();
+            if (!node->is_terminal()) {
+                node->set_nn_results(valueDistribution(generator), random_policy(node->get_number_child_nodes(), generator));
+                evaluatedNodes.push_back(node);
+            }
+        }
+        backup_value(node, -node->get_value());
+    }
+    return rootNode;
+}
+
+/**
+ * @brief benchmark_fill_nn_results Measures fill_nn_results() with random network outputs for all evaluated nodes
+ * @param variantName Name of the variant
+ * @param isPolicyMap True, if the outputs are given in the policy map representation
+ * @param searchSettings Search settings
+ * @param evaluatedNodes Expanded non-terminal nodes
+ * @param generator Random generator for the network outputs
+ * @param checksum Accumulated results
+ */
+void benchmark_fill_nn_results(const string& variantName, bool isPolicyMap, const SearchSettings* searchSettings,
+                               const vector<Node*>& evaluatedNodes, mt19937& generator, float& checksum)
+{
+    Constants::init(isPolicyMap);
+    normal_distribution<float> distribution(0.0f, 1.0f);
+    vector<float> valueOutputs(NB_BATCH_OUTPUTS);
+    vector<float> probOutputs(NB_BATCH_OUTPUTS * (isPolicyMap ? NB_LABELS_POLICY_MAP : NB_LABELS));
+    for (float& value : valueOutputs) {
+        value = tanh(distribution(generator));
+    }
+    for (float& prob : probOutputs) {
+        prob = isPolicyMap ? abs(distribution(generator)) / NB_LABELS_POLICY_MAP : distribution(generator);
+    }
+    // the cache is disabled, so that only the assignment to the node is measured
+    NNCache nnCache(0);
+    DynamicVector<float> policyProbSmall;
+    const MicrobenchmarkResult result = measure([&]() { return evaluatedNodes.size(); }, [&](size_t idx) {
+        fill_nn_results(idx % NB_BATCH_OUTPUTS, isPolicyMap, searchSettings, valueOutputs.data(), probOutputs.data(),
+                        evaluatedNodes[idx], &nnCache, policyProbSmall);
+        return 1;
+    }, [&]() { checksum += policyProbSmall.size(); });
+    print_result(variantName, isPolicyMap ? "fill_nn_results (policy map)" : "fill_nn_results (flat)", result);
+}
+}  // namespace
+
+void run_search_benchmarks(const string& variantName, const deque<Board>& positions, float& checksum)
+{
+    // the constructor sets the engine defaults, only the capture enhancement is disabled by default via the UCI options
+    SearchSettings searchSettings;
+    searchSettings.enhanceCaptures = false;
+    mt19937 generator(42);
+    unordered_map<Key, Node*> hashTable;
+
+    Board target;
+    const MicrobenchmarkResult copyResult = measure([&]() { return positions.size(); }, [&](size_t idx) {
+        target = positions[idx];
+        checksum += target.game_ply();
+        return 1;
+    }, []() {});
+    // the state info of the target belongs to the copied position
+    target.setStateInfo(nullptr);
+    print_result(variantName, "Board::operator=", copyResult);
+
+    const MicrobenchmarkResult moveGenResult = measure([&]() { return positions.size(); }, [&](size_t idx) {
+        const MoveList<LEGAL> moveList(positions[idx]);
+        checksum += moveList.size();
+        return 1;
+    }, []() {});
+    print_result(variantName, "MoveList<LEGAL>", moveGenResult);
+
+    vector<Node*> leafNodes;
+    const MicrobenchmarkResult expandResult = measure([&]() {
+        for (const Board& pos : positions) {
+            leafNodes.push_back(new Node(copy_position(pos), nullptr, MOVE_NONE, &searchSettings));
+        }
+        return leafNodes.size();
+    }, [&](size_t idx) {
+        leafNodes[idx]->expand();
+        return 1;
+    }, [&]() {
+        for (Node* node : leafNodes) {
+            checksum += node->get_number_child_nodes();
+            delete_subtree_and_hash_entries(node, &hashTable);
+        }
+        leafNodes.clear();
+    });
+    print_result(variantName, "Node::expand", expandResult);
+
+    vector<Node*> rootNodes;
+    vector<Node*> evaluatedNodes;
+    const size_t treeStep = max(positions.size() / NB_TREES, size_t(1));
+    for (size_t posIdx = 0; posIdx < positions.size(); posIdx += treeStep) {
+        rootNodes.push_back(grow_tree(positions[posIdx], &searchSettings, generator, evaluatedNodes));
+    }
+
+    // every selected child gets a virtual loss like in the search, so that the statistics change between the calls
+    vector<Node*> selectedNodes;
+    selectedNodes.reserve(evaluatedNodes.size());
+    const MicrobenchmarkResult selectResult = measure([&]() { return evaluatedNodes.size(); }, [&](size_t idx) {
+        selectedNodes.push_back(select_child_node(evaluatedNodes[idx]));
+        selectedNodes.back()->apply_virtual_loss();
+        return 1;
+    }, [&]() {
+        for (Node* node : selectedNodes) {
+            node->revert_virtual_loss();
+        }
+        selectedNodes.clear();
+    });
+    print_result(variantName, "select_child_node", selectResult);
+
+    // the backup starts at every evaluated node below the root and ends at the root
+    const MicrobenchmarkResult backupResult = measure([&]() {
+        for (Node* node : evaluatedNodes) {
+            for (Node* pathNode = node; pathNode != nullptr; pathNode = pathNode->get_parent_node()) {
+                pathNode->apply_virtual_loss();
+            }
+        }
+        return evaluatedNodes.size();
+    }, [&](size_t idx) {
+        backup_value(evaluatedNodes[idx], -evaluatedNodes[idx]->get_value());
+        return 1;
+    }, [&]() { checksum += rootNodes.front()->get_visits(); });
+    print_result(variantName, "backup_value", backupResult);
+
+    benchmark_fill_nn_results(variantName, false, &searchSettings, evaluatedNodes, generator, checksum);
+    benchmark_fill_nn_results(variantName, true, &searchSettings, evaluatedNodes, generator, checksum);
+
+    for (Node* rootNode : rootNodes) {
+        delete_subtree_and_hash_entries(rootNode, &hashTable);
+    }
+}
+#endif
@@ -33,6 +33,19 @@
 #include "thread.h"
 #include "../domain/crazyhouse/constants.h"
 #include "../domain/crazyhouse/inputrepresentation.h"
+#include <random>
+#include <deque>
+#include <fstream>
+#include <cstddef>
+#include "movegen.h"
+#include "../manager/timemanager.h"
+#include "../manager/treesnapshot.h"
+#include "../manager/treemanager.h"
+#include "uci.h"
+#include "../node.h"
+#include "../rl/compactsample.h"
+#include "../rl/match.h"
+#include "benchmarkreport.h"
 using namespace Catch::literals;
 using namespace std;
 
@@ -79,4 +92,460 @@ TEST_CASE("Anti-Chess StartFEN"){
     REQUIRE(int(sum) == 224);
     REQUIRE(int(key) == 417296);
 }
+
+#ifndef CRAZYHOUSE_ONLY
+TEST_CASE("Variant channel mapping"){
+    for (auto variantMapping : CHANNEL_MAPPING_VARIANTS) {
+        REQUIRE(get_variant_channel(variantMapping.first) == variantMapping.second);
+    }
+}
+#endif
+
+TEST_CASE("Incremental input planes"){
+    Bitboards::init();
+    Position::init();
+    Bitbases::init();
+
+#ifdef CRAZYHOUSE_ONLY
+    const vector<Variant> variants = {CRAZYHOUSE_VARIANT};
+#else
+    vector<Variant> variants;
+    for (auto variantMapping : CHANNEL_MAPPING_VARIANTS) {
+        variants.push_back(variantMapping.first);
+    }
+#endif
+    auto uiThread = make_shared<Thread>(0);
+    mt19937 generator(42);
+    const size_t nbGames = 10;
+    const size_t maxPlies = 200;
+
+    float *parentPlanes = new float[NB_VALUES_TOTAL];
+    float *expectedPlanes = new float[NB_VALUES_TOTAL];
+    float *childPlanes = new float[NB_VALUES_TOTAL];
+    float *siblingPlanes = new float[NB_VALUES_TOTAL];
+
+    for (Variant variant : variants) {
+        for (size_t gameIdx = 0; gameIdx < nbGames; ++gameIdx) {
+            // the states must stay valid for all positions of the game
+            deque<StateInfo> states(1);
+            Board pos;
+            pos.set(StartFENs[variant], false, variant, &states.back(), uiThread.get());
+            const bool normalize = gameIdx % 2 == 0;
+            board_to_planes(&pos, 0, normalize, parentPlanes);
+
+            for (size_t ply = 0; ply < maxPlies; ++ply) {
+                const MoveList<LEGAL> moveList(pos);
+                const vector<ExtMove> legalMoves(moveList.begin(), moveList.end());
+                if (legalMoves.size() == 0) {
+                    break;
+                }
+                Board parent(pos);
+                const Move move = legalMoves[generator() % legalMoves.size()];
+                const Move siblingMove = legalMoves[generator() % legalMoves.size()];
+
+                Board sibling(parent);
+                states.emplace_back();
+                sibling.do_move(siblingMove, states.back());
+                board_to_planes(&sibling, 0, normalize, siblingPlanes);
+
+                states.emplace_back();
+                pos.do_move(move, states.back());
+                const int repetition = pos.getStateInfo()->repetition;
+                board_to_planes(&pos, repetition, normalize, expectedPlanes);
+
+                // derive the child from its parent
+                board_to_planes_incremental(&parent, parentPlanes, &pos, repetition, normalize, childPlanes);
+                REQUIRE(equal(expectedPlanes, expectedPlanes+NB_VALUES_TOTAL, childPlanes));
+
+                // derive the child from a sibling
+                board_to_planes_incremental(&sibling, siblingPlanes, &pos, repetition, normalize, siblingPlanes);
+                REQUIRE(equal(expectedPlanes, expectedPlanes+NB_VALUES_TOTAL, siblingPlanes));
+
+                // update the parent encoding in place
+                board_to_planes_incremental(&parent, parentPlanes, &pos, repetition, normalize, parentPlanes);
+                REQUIRE(equal(expectedPlanes, expectedPlanes+NB_VALUES_TOTAL, parentPlanes));
+                // the states are owned by the deque
+                parent.setStateInfo(nullptr);
+                sibling.setStateInfo(nullptr);
+            }
+            pos.setStateInfo(nullptr);
+        }
+    }
+    delete[] parentPlanes;
+    delete[] expectedPlanes;
+    delete[] childPlanes;
+    delete[] siblingPlanes;
+}
+
+TEST_CASE("Compact training samples"){
+    Bitboards::init();
+    Position::init();
+    Bitbases::init();
+    Constants::init(false);
+
+#ifdef CRAZYHOUSE_ONLY
+    const vector<Variant> variants = {CRAZYHOUSE_VARIANT};
+#else
+    vector<Variant> variants;
+    for (auto variantMapping : CHANNEL_MAPPING_VARIANTS) {
+        variants.push_back(variantMapping.first);
+    }
+#endif
+    auto uiThread = make_shared<Thread>(0);
+    mt19937 generator(42);
+    const size_t nbGames = 5;
+    const size_t maxPlies = 200;
+
+    float *planes = new float[NB_VALUES_TOTAL];
+    int16_t *expandedPlanes = new int16_t[NB_VALUES_TOTAL];
+    float *expectedPolicy = new float[NB_LABELS];
+    float *expandedPolicy = new float[NB_LABELS];
+    uint64_t bitboards[NB_CHANNELS_TOTAL];
+    int16_t scalars[NB_CHANNELS_TOTAL];
+
+    for (Variant variant : variants) {
+        for (size_t gameIdx = 0; gameIdx < nbGames; ++gameIdx) {
+            deque<StateInfo> states(1);
+            Board pos;
+            pos.set(StartFENs[variant], false, variant, &states.back(), uiThread.get());
+
+            for (size_t ply = 0; ply < maxPlies; ++ply) {
+                const MoveList<LEGAL> moveList(pos);
+                const vector<Move> legalMoves(moveList.begin(), moveList.end());
+                if (legalMoves.size() == 0) {
+                    break;
+                }
+
+                // the exported planes are unnormalized
+                board_to_planes(&pos, pos.getStateInfo()->repetition, false, planes);
+                REQUIRE(compress_planes(planes, bitboards, scalars));
+                expand_planes(bitboards, scalars, expandedPlanes);
+                for (size_t idx = 0; idx < NB_VALUES_TOTAL; ++idx) {
+                    REQUIRE(expandedPlanes[idx] == int16_t(planes[idx]));
+                }
+
+                // the policy of unvisited moves is zero
+                DynamicVector<float> policyProbSmall(legalMoves.size());
+                fill(expectedPolicy, expectedPolicy+NB_LABELS, 0.0f);
+                for (size_t idx = 0; idx < legalMoves.size(); ++idx) {
+                    policyProbSmall[idx] = generator() % 3 == 0 ? 0.0f : float(generator() % 1000) / 1000.0f;
+                    expectedPolicy[get_policy_index(legalMoves[idx], pos.side_to_move())] = policyProbSmall[idx];
+                }
+                vector<int16_t> indices;
+                vector<float> probs;
+                const size_t numberEntries = compress_policy(legalMoves, policyProbSmall, pos.side_to_move(), indices, probs);
+                REQUIRE(numberEntries == indices.size());
+                REQUIRE(numberEntries <= legalMoves.size());
+                expand_policy(indices.data(), probs.data(), numberEntries, expandedPolicy);
+                REQUIRE(equal(expectedPolicy, expectedPolicy+NB_LABELS, expandedPolicy));
+
+                states.emplace_back();
+                pos.do_move(legalMoves[generator() % legalMoves.size()], states.back());
+            }
+            // the states are owned by the deque
+            pos.setStateInfo(nullptr);
+        }
+    }
+    delete[] planes;
+    delete[] expandedPlanes;
+    delete[] expectedPolicy;
+    delete[] expandedPolicy;
+}
+
+TEST_CASE("Match Elo"){
+    REQUIRE(score_to_elo(0.5f) == Approx(0.0f));
+    REQUIRE(score_to_elo(0.75f) == Approx(190.85f).epsilon(0.001));
+    REQUIRE(score_to_elo(0.25f) == Approx(-score_to_elo(0.75f)));
+
+    // a match without decisive games has no uncertainty
+    MatchResult result;
+    result.draws = 100;
+    float elo;
+    float eloError;
+    compute_elo(result, elo, eloError);
+    REQUIRE(elo == Approx(0.0f));
+    REQUIRE(eloError == Approx(0.0f));
+
+    // the error bars shrink with the number of games
+    result.wins = 30;
+    result.draws = 40;
+    result.losses = 30;
+    compute_elo(result, elo, eloError);
+    REQUIRE(elo == Approx(0.0f).margin(1e-3));
+    const float errorSmallMatch = eloError;
+    result.wins = 300;
+    result.draws = 400;
+    result.losses = 300;
+    compute_elo(result, elo, eloError);
+    REQUIRE(eloError < errorSmallMatch);
+    REQUIRE(eloError > 0);
+
+    // a perfect score is clamped instead of becoming infinite
+    result = MatchResult();
+    result.wins = 10;
+    compute_elo(result, elo, eloError);
+    REQUIRE(isfinite(elo));
+    REQUIRE(elo > 0);
+}
+
+TEST_CASE("Match terminal position"){
+    Bitboards::init();
+    Position::init();
+    Bitbases::init();
+
+    auto uiThread = make_shared<Thread>(0);
+    Board pos;
+    StateInfo state;
+    float value;
+    pos.set(StartFENs[CHESS_VARIANT], false, CHESS_VARIANT, &state, uiThread.get());
+    REQUIRE(!is_terminal_position(pos, value));
+
+    // fool's mate
+    pos.set("rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3", false, CHESS_VARIANT, &state, uiThread.get());
+    REQUIRE(is_terminal_position(pos, value));
+    REQUIRE(value == LOSS);
+
+    // stalemate
+    pos.set("7k/5Q2/6K1/8/8/8/8/8 b - - 0 1", false, CHESS_VARIANT, &state, uiThread.get());
+    REQUIRE(is_terminal_position(pos, value));
+    REQUIRE(value == DRAW);
+    pos.setStateInfo(nullptr);
+}
+
+TEST_CASE("Benchmark baseline"){
+    PositionBenchmark result;
+    result.fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    result.bestMove = "e2e4";
+    result.blunderMove = "e2e4";
+    result.nodes = 1000;
+    result.nps = 1000;
+    result.depth = 10;
+    result.elapsedTimeMS = 1000;
+    result.treeMemory = 1 << 20;
+    result.batchFill = 0.5f;
+    result.collisionRatio = 0.1f;
+    result.timeToFirstBatchMS = -1;
+    REQUIRE(!result.is_passed());
+
+    nlohmann::json settings;
+    settings["threads"] = 2;
+    const nlohmann::json baseline = create_benchmark_report({result}, settings);
+    REQUIRE(baseline["summary"]["passed"].get<size_t>() == 0);
+    REQUIRE(baseline["summary"]["time_to_first_batch_ms"].get<double>() == Approx(-1.0));
+    REQUIRE(compare_to_baseline(baseline, baseline, BENCHMARK_DEFAULT_THRESHOLD));
+
+    // a small loss stays within the threshold, a larger loss of the NPS is a regression
+    result.nps = 970;
+    REQUIRE(compare_to_baseline(create_benchmark_report({result}, settings), baseline, BENCHMARK_DEFAULT_THRESHOLD));
+    result.nps = 900;
+    REQUIRE(!compare_to_baseline(create_benchmark_report({result}, settings), baseline, BENCHMARK_DEFAULT_THRESHOLD));
+    // the other metrics aren't gated
+    result.nps = 1000;
+    result.depth = 5;
+    REQUIRE(compare_to_baseline(create_benchmark_report({result}, settings), baseline, BENCHMARK_DEFAULT_THRESHOLD));
+}
+
+TEST_CASE("Time bank"){
+    TimeManager timeManager;
+    SearchLimits searchLimits;
+    searchLimits.time[WHITE] = 60000;
+    searchLimits.time[BLACK] = 60000;
+    searchLimits.moveOverhead = 50;
+    const int movetime = timeManager.get_time_for_move(&searchLimits, WHITE, 10);
+    timeManager.save_time(&searchLimits, WHITE, 500);
+    timeManager.save_time(&searchLimits, WHITE, -100);
+    REQUIRE(timeManager.get_time_bank(WHITE) == 500);
+    REQUIRE(timeManager.get_time_bank(BLACK) == 0);
+
+    // the banked time isn't spread over the regular moves a second time
+    REQUIRE(timeManager.get_time_for_move(&searchLimits, WHITE, 10) < movetime);
+    REQUIRE(timeManager.get_time_for_move(&searchLimits, BLACK, 10) == movetime);
+    REQUIRE(timeManager.take_from_time_bank(BLACK, 200) == 0);
+    REQUIRE(timeManager.take_from_time_bank(WHITE, 200) == 200);
+    REQUIRE(timeManager.take_from_time_bank(WHITE, 1000) == 300);
+    REQUIRE(timeManager.get_time_bank(WHITE) == 0);
+
+    // time can't be banked for a fixed movetime
+    searchLimits.movetime = 1000;
+    timeManager.save_time(&searchLimits, WHITE, 500);
+    REQUIRE(timeManager.get_time_bank(WHITE) == 0);
+}
+
+TEST_CASE("Adaptive move overhead"){
+    TimeManager timeManager;
+    SearchLimits searchLimits;
+    searchLimits.movetime = 1000;
+    searchLimits.moveOverhead = 50;
+    searchLimits.adaptiveMoveOverhead = true;
+    for (int sample = 0; sample < MIN_LAG_SAMPLES; ++sample) {
+        REQUIRE(timeManager.get_move_overhead(&searchLimits, WHITE) == 50);
+        timeManager.update_move_overhead(&searchLimits, WHITE, 20);
+    }
+    REQUIRE(timeManager.get_move_overhead(&searchLimits, WHITE) == 20);
+    REQUIRE(timeManager.get_time_for_move(&searchLimits, WHITE, 10) == 980);
+
+    // other time controls are calibrated separately
+    searchLimits.movetime = 2000;
+    REQUIRE(timeManager.get_move_overhead(&searchLimits, WHITE) == 50);
+    searchLimits.movetime = 1000;
+    searchLimits.adaptiveMoveOverhead = false;
+    REQUIRE(timeManager.get_move_overhead(&searchLimits, WHITE) == 50);
+}
+
+TEST_CASE("Tree snapshot"){
+    Bitboards::init();
+    Position::init();
+    Bitbases::init();
+
+    SearchSettings searchSettings = {};
+    searchSettings.virtualLoss = 3;
+    searchSettings.cpuctInit = 2.5f;
+    searchSettings.cpuctBase = 19652;
+    searchSettings.uInit = 1;
+    searchSettings.uMin = 0.25f;
+    searchSettings.uBase = 1965;
+    auto uiThread = make_shared<Thread>(0);
+    Board pos;
+    StateInfo state;
+    pos.set(StartFENs[CHESS_VARIANT], false, CHESS_VARIANT, &state, uiThread.get());
+
+    // build a tree with an evaluated root and one evaluated child node
+    Board* rootPos = new Board(pos);
+    rootPos->setStateInfo(new StateInfo(state));
+    Node* rootNode = new Node(rootPos, nullptr, MOVE_NONE, &searchSettings);
+    rootNode->expand();
+    rootNode->set_nn_results(0.1f, DynamicVector<float>(rootNode->get_number_child_nodes(), 0.05f));
+    Node* childNode = rootNode->get_child_nodes()[3];
+    childNode->init_board();
+    childNode->expand();
+    childNode->set_nn_results(-0.2f, DynamicVector<float>(childNode->get_number_child_nodes(), 0.05f));
+    rootNode->apply_virtual_loss();
+    childNode->apply_virtual_loss();
+    backup_value(childNode, 0.2f);
+
+    const string filename = "tree_snapshot_test.bin";
+    const size_t numberNodes = 1 + rootNode->get_number_child_nodes() + childNode->get_number_child_nodes();
+    REQUIRE(save_tree(rootNode, filename) == numberNodes);
+
+    TreeSnapshot snapshot;
+    REQUIRE(snapshot.open(filename));
+    REQUIRE(snapshot.get_number_records() == numberNodes);
+    REQUIRE(snapshot.get_root_key() == rootNode->hash_key());
+    REQUIRE(snapshot.get_fen() == pos.fen());
+
+    Board* loadedPos = new Board(pos);
+    loadedPos->setStateInfo(new StateInfo(state));
+    Node* loadedRoot = new Node(loadedPos, nullptr, MOVE_NONE, &searchSettings);
+    loadedRoot->expand();
+    loadedRoot->set_snapshot_record(&snapshot, 0);
+    loadedRoot->restore_from_snapshot();
+    REQUIRE(loadedRoot->has_nn_results());
+    REQUIRE(loadedRoot->get_visits() == rootNode->get_visits());
+    for (const Node* loadedChild : loadedRoot->get_child_nodes()) {
+        const bool isVisited = loadedChild->get_move() == childNode->get_move();
+        REQUIRE(loadedChild->get_prob_value() == 0.05f);
+        REQUIRE(loadedChild->get_visits() == (isVisited ? childNode->get_visits() : 0));
+        REQUIRE(loadedChild->has_snapshot_record() == isVisited);
+    }
+    // the subtrees which haven't been materialized are taken from the snapshot
+    const string secondFilename = "tree_snapshot_test_2.bin";
+    REQUIRE(save_tree(loadedRoot, secondFilename) == numberNodes);
+
+    // the unmaterialized subtree survives a second save and load
+    TreeSnapshot secondSnapshot;
+    REQUIRE(secondSnapshot.open(secondFilename));
+    REQUIRE(secondSnapshot.get_number_records() == numberNodes);
+    Board* reloadedPos = new Board(pos);
+    reloadedPos->setStateInfo(new StateInfo(state));
+    Node* reloadedRoot = new Node(reloadedPos, nullptr, MOVE_NONE, &searchSettings);
+    reloadedRoot->expand();
+    reloadedRoot->set_snapshot_record(&secondSnapshot, 0);
+    reloadedRoot->restore_from_snapshot();
+    for (const Node* reloadedChild : reloadedRoot->get_child_nodes()) {
+        const bool isVisited = reloadedChild->get_move() == childNode->get_move();
+        REQUIRE(reloadedChild->get_visits() == (isVisited ? childNode->get_visits() : 0));
+        REQUIRE(reloadedChild->has_snapshot_record() == isVisited);
+    }
+
+    // a child index which points back to the root would create a cycle
+    const string corruptFilename = "tree_snapshot_test_corrupt.bin";
+    {
+        ifstream source(secondFilename, ios::binary | ios::ate);
+        const size_t fileSize = size_t(source.tellg());
+        source.seekg(0);
+        ofstream corruptFile(corruptFilename, ios::binary);
+        corruptFile << source.rdbuf();
+        // the records are stored at the end of the file
+        const size_t rootRecordOffset = fileSize - numberNodes * sizeof(TreeNodeRecord);
+        const uint32_t firstChildIdx = 0;
+        corruptFile.seekp(rootRecordOffset + offsetof(TreeNodeRecord, firstChildIdx));
+        corruptFile.write(reinterpret_cast<const char*>(&firstChildIdx), sizeof(firstChildIdx));
+    }
+    TreeSnapshot corruptSnapshot;
+    REQUIRE(!corruptSnapshot.open(corruptFilename));
+    remove(corruptFilename.c_str());
+
+    unordered_map<Key, Node*> hashTable;
+    delete_subtree_and_hash_entries(rootNode, &hashTable);
+    delete_subtree_and_hash_entries(loadedRoot, &hashTable);
+    delete_subtree_and_hash_entries(reloadedRoot, &hashTable);
+    pos.setStateInfo(nullptr);
+    remove(filename.c_str());
+    remove(secondFilename.c_str());
+}
+
+/**
+ * @brief expand_child_node Expands the child node of the given move
+ * @return Child node
+ */
+Node* expand_child_node(Node* node, string uciMove)
+{
+    const Move move = UCI::to_move(*node->get_pos(), uciMove);
+    for (Node* childNode : node->get_child_nodes()) {
+        if (childNode->get_move() == move) {
+            childNode->init_board();
+            childNode->expand();
+            return childNode;
+        }
+    }
+    return nullptr;
+}
+
+TEST_CASE("Reclaimed game nodes"){
+    Bitboards::init();
+    Position::init();
+    Bitbases::init();
+
+    SearchSettings searchSettings = {};
+    auto uiThread = make_shared<Thread>(0);
+    StateInfo state;
+    Board pos;
+    pos.set(StartFENs[CHESS_VARIANT], false, CHESS_VARIANT, &state, uiThread.get());
+    Board* rootPos = new Board(pos);
+    rootPos->setStateInfo(new StateInfo(state));
+    pos.setStateInfo(nullptr);
+    Node* rootNode = new Node(rootPos, nullptr, MOVE_NONE, &searchSettings);
+    rootNode->expand();
+
+    // the engine played e2e4 and the opponent's reply was applied to the tree,
+    // afterwards the analysis jumps to the line d2d4 d7d5
+    Node* opponentsNextRoot = expand_child_node(rootNode, "e2e4");
+    Node* ownNextRoot = expand_child_node(opponentsNextRoot, "d7d5");
+    Node* d4Node = expand_child_node(rootNode, "d2d4");
+    Node* d5Node = expand_child_node(d4Node, "d7d5");
+    REQUIRE(ownNextRoot != nullptr);
+    REQUIRE(d5Node != nullptr);
+
+    vector<Node*> gameNodes = {rootNode, opponentsNextRoot, ownNextRoot};
+    for (Node* node : {d4Node, d5Node}) {
+        remove_sibling_subtree_nodes(gameNodes, node);
+        gameNodes.push_back(node);
+    }
+    // the nodes of the e2e4 subtree are freed with the sibling subtrees of d2d4
+    REQUIRE(gameNodes == vector<Node*>({rootNode, d4Node, d5Node}));
+
+    unordered_map<Key, Node*> hashTable;
+    delete_subtree_and_hash_entries(rootNode, &hashTable);
+}
+
 #endif
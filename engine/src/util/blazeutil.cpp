@@ -29,12 +29,12 @@
 DynamicVector<float> get_dirichlet_noise(size_t length, const float alpha)
 {
     DynamicVector<float> dirichletNoise(length);
-    auto seed = time(0); //std::chrono::high_resolution_clock::now().time_since_epoch().count();
-    generator.seed(seed);
+    // every thread draws from its own generator, so that games which run in parallel get different noise
+    thread_local std::default_random_engine noiseGenerator(r());
 
     for (size_t i = 0; i < length; ++i) {
         std::gamma_distribution<float> distribution(alpha, 1.0f);
-        dirichletNoise[i] = distribution(generator);
+        dirichletNoise[i] = distribution(noiseGenerator);
     }
     dirichletNoise /= sum(dirichletNoise);
     return  dirichletNoise;